@@ -3,6 +3,7 @@
 #include <ast/node-visitor.h>
 #include <ast/stmt.h>
 #include <semantic/semantic-analyzer.h>
+#include <utility>
 
 void ast::VariableDeclaration::dump(std::ostream &os, int indent) const
 {
@@ -31,6 +32,13 @@ void ast::VariableDeclaration::accept(NodeVisitor &v)
     v.visit(*this);
 }
 
+std::unique_ptr<ast::Expression>
+ast::VariableDeclaration::replace_child(Expression const &child,
+                                        std::unique_ptr<Expression> replacement)
+{
+    return replace_in({&init_}, child, std::move(replacement));
+}
+
 void ast::FunctionDeclaration::dump(std::ostream &os, int indent) const
 {
     make_indent(os, indent);
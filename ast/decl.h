@@ -3,7 +3,9 @@
 #include <ast/node.h>
 #include <ast/type.h>
 #include <lex/token.h>
+#include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace semantic {
@@ -46,6 +48,10 @@ class VariableDeclaration : public Declaration {
 
     void accept(NodeVisitor &v) override;
 
+    std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement) override;
+
     [[nodiscard]] auto &&name() const
     {
         return name_;
@@ -66,12 +72,26 @@ class VariableDeclaration : public Declaration {
         return resolved_type_;
     }
 
+    /// @brief Whether the array this declaration makes dies with its frame,
+    /// so that engines free it when the declaration runs again or the frame
+    /// is left. Set by the EscapeAnalysis.
+    [[nodiscard]] bool owns_array() const
+    {
+        return owns_array_;
+    }
+
+    void set_owns_array(bool owns)
+    {
+        owns_array_ = owns;
+    }
+
   private:
     std::string name_;
     TypePtr declared_type_;
     ExpressionPtr init_;
 
     semantic::Type *resolved_type_{};
+    bool owns_array_{};
 };
 
 class FunctionDeclaration : public Declaration {
@@ -107,6 +127,30 @@ class FunctionDeclaration : public Declaration {
         return parameters_;
     }
 
+    /// @brief Number of value slots a call of this function needs for its
+    /// parameters and locals. Set by the semantic analyzer.
+    [[nodiscard]] std::size_t frame_size() const
+    {
+        return frame_size_;
+    }
+
+    void set_frame_size(std::size_t size)
+    {
+        frame_size_ = size;
+    }
+
+    /// @brief Slots whose arrays to free when a call of this function
+    /// leaves its frame. Set by the EscapeAnalysis.
+    [[nodiscard]] std::vector<std::uint32_t> const &frame_arrays() const
+    {
+        return frame_arrays_;
+    }
+
+    void set_frame_arrays(std::vector<std::uint32_t> slots)
+    {
+        frame_arrays_ = std::move(slots);
+    }
+
   private:
     struct Parameter {
         TypePtr type;
@@ -118,6 +162,8 @@ class FunctionDeclaration : public Declaration {
     std::string name_;
     std::vector<Parameter> parameters_;
     std::unique_ptr<CompoundStatement> body_;
+    std::size_t frame_size_{};
+    std::vector<std::uint32_t> frame_arrays_;
 };
 
 } // namespace ast
@@ -1,11 +1,25 @@
 #include <ast/expr.h>
 #include <semantic/semantic-analyzer.h>
+#include <string>
+#include <utility>
 
 void ast::IntegerLiteralExpr::accept(NodeVisitor &v)
 {
     v.visit(*this);
 }
 
+std::unique_ptr<ast::IntegerLiteralExpr>
+ast::IntegerLiteralExpr::make(std::int64_t value, semantic::Type *type,
+                              SourceRange range)
+{
+    auto literal = std::make_unique<IntegerLiteralExpr>();
+    literal->set_value(std::to_string(value));
+    literal->set_type(type);
+    literal->set_source_begin(range.begin);
+    literal->set_source_end(range.end);
+    return literal;
+}
+
 void ast::FloatLiteralExpr::accept(NodeVisitor &v)
 {
     v.visit(*this);
@@ -26,17 +40,50 @@ void ast::CallExpression::accept(NodeVisitor &v)
     v.visit(*this);
 }
 
+std::unique_ptr<ast::Expression>
+ast::CallExpression::replace_child(Expression const &child,
+                                   std::unique_ptr<Expression> replacement)
+{
+    for (auto &arg : arguments_) {
+        if (arg.get() == &child) {
+            return replace_in({&arg}, child, std::move(replacement));
+        }
+    }
+    return replace_in({&callee_}, child, std::move(replacement));
+}
+
 void ast::UnaryExpression::accept(NodeVisitor &v)
 {
     v.visit(*this);
 }
 
+std::unique_ptr<ast::Expression>
+ast::UnaryExpression::replace_child(Expression const &child,
+                                    std::unique_ptr<Expression> replacement)
+{
+    return replace_in({&expr_}, child, std::move(replacement));
+}
+
 void ast::BinaryExpression::accept(NodeVisitor &v)
 {
     v.visit(*this);
 }
 
+std::unique_ptr<ast::Expression>
+ast::BinaryExpression::replace_child(Expression const &child,
+                                     std::unique_ptr<Expression> replacement)
+{
+    return replace_in({&lhs_, &rhs_}, child, std::move(replacement));
+}
+
 void ast::IndexExpression::accept(NodeVisitor &v)
 {
     v.visit(*this);
 }
+
+std::unique_ptr<ast::Expression>
+ast::IndexExpression::replace_child(Expression const &child,
+                                    std::unique_ptr<Expression> replacement)
+{
+    return replace_in({&base_, &index_}, child, std::move(replacement));
+}
@@ -1,6 +1,10 @@
 #pragma once
 #include <ast/node.h>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <semantic/builtin.h>
+#include <semantic/opcode.h>
 #include <semantic/symbol.h>
 #include <semantic/type.h>
 #include <vector>
@@ -10,6 +14,7 @@ class Parser;
 namespace ast {
 
 class NodeVisitor;
+class FunctionDeclaration;
 
 class Expression : public Node {
   public:
@@ -57,9 +62,9 @@ class IntegerLiteralExpr : public PrimaryExpression {
 
     void accept(NodeVisitor &v) override;
 
-    [[nodiscard]] auto value() const
+    [[nodiscard]] std::int64_t value() const
     {
-        return std::stoll(value_);
+        return number_;
     }
 
     [[nodiscard]] std::string const &strvalue() const
@@ -67,8 +72,20 @@ class IntegerLiteralExpr : public PrimaryExpression {
         return value_;
     }
 
+    /// @brief A literal of `type` standing for `value`, computed from the
+    /// expression at `range`.
+    static std::unique_ptr<IntegerLiteralExpr>
+    make(std::int64_t value, semantic::Type *type, SourceRange range);
+
   private:
+    void set_value(std::string value)
+    {
+        number_ = std::stoll(value);
+        value_ = std::move(value);
+    }
+
     std::string value_;
+    std::int64_t number_{}; // Parsed once, as engines read it often
 };
 
 class FloatLiteralExpr : public PrimaryExpression {
@@ -158,6 +175,10 @@ class CallExpression : public PostfixExpression {
 
     void accept(NodeVisitor &v) override;
 
+    std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement) override;
+
     [[nodiscard]] ExpressionPtr const &callee() const
     {
         return callee_;
@@ -168,9 +189,33 @@ class CallExpression : public PostfixExpression {
         return arguments_;
     }
 
+    /// @brief The function called, resolved by the semantic analyzer once
+    /// per call site. Null for builtins.
+    [[nodiscard]] FunctionDeclaration *target() const
+    {
+        return target_;
+    }
+
+    void set_target(FunctionDeclaration *target)
+    {
+        target_ = target;
+    }
+
+    [[nodiscard]] semantic::Builtin builtin() const
+    {
+        return builtin_;
+    }
+
+    void set_builtin(semantic::Builtin builtin)
+    {
+        builtin_ = builtin;
+    }
+
   private:
     ExpressionPtr callee_;
     std::vector<ExpressionPtr> arguments_;
+    FunctionDeclaration *target_{};
+    semantic::Builtin builtin_{};
 };
 
 class IndexExpression : public PostfixExpression {
@@ -193,6 +238,10 @@ class IndexExpression : public PostfixExpression {
 
     void accept(NodeVisitor &v) override;
 
+    std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement) override;
+
     [[nodiscard]] ExpressionPtr const &base() const
     {
         return base_;
@@ -203,9 +252,32 @@ class IndexExpression : public PostfixExpression {
         return index_;
     }
 
+    [[nodiscard]] semantic::OpCode opcode() const
+    {
+        return opcode_;
+    }
+
+    void set_opcode(semantic::OpCode opcode)
+    {
+        opcode_ = opcode;
+    }
+
+    /// @brief Size of the element type, in bytes.
+    [[nodiscard]] std::size_t stride() const
+    {
+        return stride_;
+    }
+
+    void set_stride(std::size_t stride)
+    {
+        stride_ = stride;
+    }
+
   private:
     ExpressionPtr base_;
     ExpressionPtr index_;
+    semantic::OpCode opcode_{};
+    std::size_t stride_{};
 };
 
 class UnaryExpression : public Expression {
@@ -223,6 +295,10 @@ class UnaryExpression : public Expression {
 
     void accept(NodeVisitor &v) override;
 
+    std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement) override;
+
     [[nodiscard]] std::string const &op() const
     {
         return op_;
@@ -233,9 +309,20 @@ class UnaryExpression : public Expression {
         return expr_;
     }
 
+    [[nodiscard]] semantic::OpCode opcode() const
+    {
+        return opcode_;
+    }
+
+    void set_opcode(semantic::OpCode opcode)
+    {
+        opcode_ = opcode;
+    }
+
   private:
     std::string op_;
     ExpressionPtr expr_;
+    semantic::OpCode opcode_{};
 };
 
 class BinaryExpression : public Expression {
@@ -254,6 +341,10 @@ class BinaryExpression : public Expression {
 
     void accept(NodeVisitor &v) override;
 
+    std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement) override;
+
     [[nodiscard]] Token const &op() const
     {
         return op_;
@@ -269,10 +360,21 @@ class BinaryExpression : public Expression {
         return rhs_;
     }
 
+    [[nodiscard]] semantic::OpCode opcode() const
+    {
+        return opcode_;
+    }
+
+    void set_opcode(semantic::OpCode opcode)
+    {
+        opcode_ = opcode;
+    }
+
   private:
     Token op_;
     ExpressionPtr lhs_;
     ExpressionPtr rhs_;
+    semantic::OpCode opcode_{};
 };
 
 } // namespace ast
@@ -1 +1,25 @@
 #include <ast/node.h>
+
+#include <ast/expr.h>
+#include <stdexcept>
+#include <utility>
+
+std::unique_ptr<ast::Expression>
+ast::Node::replace_child(Expression const &child,
+                         std::unique_ptr<Expression> replacement)
+{
+    return replace_in({}, child, std::move(replacement));
+}
+
+std::unique_ptr<ast::Expression> ast::Node::replace_in(
+    std::initializer_list<std::unique_ptr<Expression> *> slots,
+    Expression const &child, std::unique_ptr<Expression> replacement)
+{
+    for (auto *slot : slots) {
+        if (slot->get() == &child) {
+            slot->swap(replacement);
+            return replacement;
+        }
+    }
+    throw std::logic_error{"Not a child expression"};
+}
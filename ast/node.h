@@ -1,6 +1,8 @@
 #pragma once
 #include <cassert>
+#include <initializer_list>
 #include <lex/token.h>
+#include <memory>
 #include <ostream>
 
 inline void make_indent(std::ostream &os, int n)
@@ -13,6 +15,7 @@ inline void make_indent(std::ostream &os, int n)
 namespace ast {
 
 class NodeVisitor;
+class Expression;
 
 class Node {
   public:
@@ -32,6 +35,13 @@ class Node {
         return source_range_;
     }
 
+    /// @brief Puts `replacement` in place of the child expression `child`
+    /// and returns the latter, for passes rewriting the tree such as the
+    /// ConstantEvaluator. Throws if `child` isn't a child of this node.
+    virtual std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement);
+
   protected:
     void set_source_begin(SourceLocation sb)
     {
@@ -43,6 +53,12 @@ class Node {
         source_range_.end = se;
     }
 
+    /// @brief replace_child() over the expressions held in `slots`.
+    static std::unique_ptr<Expression>
+    replace_in(std::initializer_list<std::unique_ptr<Expression> *> slots,
+               Expression const &child,
+               std::unique_ptr<Expression> replacement);
+
   private:
     SourceRange source_range_{};
 };
@@ -0,0 +1,84 @@
+#pragma once
+#include <ast/ast.h>
+#include <concepts>
+#include <diagnostics.h>
+#include <functional>
+#include <memory>
+#include <ranges>
+#include <thread-pool.h>
+#include <vector>
+
+namespace ast {
+
+/// @brief Collects the top-level function declarations of a program, in
+/// declaration order.
+inline std::vector<FunctionDeclaration *> function_declarations(Program &prog)
+{
+    std::vector<FunctionDeclaration *> result;
+    for (auto const &ds : prog.declaration_statements()) {
+        if (auto *fd =
+                dynamic_cast<FunctionDeclaration *>(ds->declaration().get())) {
+            result.push_back(fd);
+        }
+    }
+    return result;
+}
+
+/// @brief Runs a visitor over every top-level function of a program, one task
+/// per function, on a thread pool.
+///
+/// Global symbols must already be known: function bodies are then independent,
+/// and each task owns a fresh visitor instance made by the factory (called on
+/// the calling thread) together with a buffered Diagnostics. Once all tasks
+/// finish, the buffered diagnostics are flushed into the caller's sink and
+/// `merge` is called on the calling thread, both in declaration order, so
+/// results are deterministic regardless of scheduling.
+template <std::derived_from<NodeVisitor> Visitor>
+class ParallelFunctionVisitor {
+  public:
+    using Factory = std::function<std::unique_ptr<Visitor>(Diagnostics *)>;
+    using Merge = std::function<void(FunctionDeclaration &, Visitor &)>;
+
+    ParallelFunctionVisitor(ThreadPool *pool, Factory factory)
+        : pool_(pool), factory_(std::move(factory))
+    {
+    }
+
+    void run(Program &prog, Diagnostics *diags, Merge const &merge = {})
+    {
+        run(function_declarations(prog), diags, merge);
+    }
+
+    void run(std::vector<FunctionDeclaration *> const &functions,
+             Diagnostics *diags, Merge const &merge = {})
+    {
+        struct Task {
+            Diagnostics diags{Diagnostics::Mode::buffered};
+            std::unique_ptr<Visitor> visitor;
+        };
+
+        std::vector<std::unique_ptr<Task>> tasks;
+        tasks.reserve(functions.size());
+        for (auto *fd : functions) {
+            // Visitors are made here, in declaration order, so the factory
+            // itself needn't be thread-safe.
+            auto *task = tasks.emplace_back(std::make_unique<Task>()).get();
+            task->visitor = factory_(&task->diags);
+            pool_->submit([fd, task] { fd->accept(*task->visitor); });
+        }
+        pool_->wait();
+
+        for (auto const &[fd, task] : std::views::zip(functions, tasks)) {
+            task->diags.flush_into(*diags);
+            if (merge) {
+                merge(*fd, *task->visitor);
+            }
+        }
+    }
+
+  private:
+    ThreadPool *pool_;
+    Factory factory_;
+};
+
+} // namespace ast
@@ -1,11 +1,14 @@
 #pragma once
 #include <ast/stmt.h>
+#include <cstddef>
+#include <utility>
 #include <vector>
 
 namespace semantic {
 
 class Scope;
 class SemanticAnalyzer;
+class IncrementalAnalyzer;
 
 } // namespace semantic
 
@@ -14,6 +17,7 @@ namespace ast {
 class Program : public Node {
     friend class ::Parser;
     friend class semantic::SemanticAnalyzer;
+    friend class semantic::IncrementalAnalyzer;
 
   public:
     Program();
@@ -28,14 +32,29 @@ class Program : public Node {
         return decls_;
     }
 
+    /// @brief Replaces the `i`-th top-level declaration, e.g. after an edit,
+    /// and returns the old one.
+    std::unique_ptr<DeclarationStatement>
+    replace_declaration(std::size_t i, std::unique_ptr<DeclarationStatement> ds)
+    {
+        return std::exchange(decls_.at(i), std::move(ds));
+    }
+
     [[nodiscard]] semantic::Scope *global_scope() const
     {
         return global_scope_;
     }
 
+    /// @brief Number of value slots for global variables.
+    [[nodiscard]] std::size_t global_frame_size() const
+    {
+        return global_frame_size_;
+    }
+
   private:
     std::vector<std::unique_ptr<DeclarationStatement>> decls_;
     semantic::Scope *global_scope_{};
+    std::size_t global_frame_size_{};
 };
 
 } // namespace ast
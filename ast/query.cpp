@@ -0,0 +1,284 @@
+#include <ast/query.h>
+
+#include <ast/recursive-node-visitor.h>
+
+namespace ast {
+
+std::string_view to_string(NodeKind kind) noexcept
+{
+    using enum NodeKind;
+
+    switch (kind) {
+    case program:
+        return "program";
+    case variable_declaration:
+        return "variable_declaration";
+    case function_declaration:
+        return "function_declaration";
+    case compound_statement:
+        return "compound_statement";
+    case declaration_statement:
+        return "declaration_statement";
+    case expression_statement:
+        return "expression_statement";
+    case return_statement:
+        return "return_statement";
+    case if_statement:
+        return "if_statement";
+    case while_statement:
+        return "while_statement";
+    case identifier_expression:
+        return "identifier_expression";
+    case unary_expression:
+        return "unary_expression";
+    case binary_expression:
+        return "binary_expression";
+    case call_expression:
+        return "call_expression";
+    case index_expression:
+        return "index_expression";
+    case integer_literal:
+        return "integer_literal";
+    case float_literal:
+        return "float_literal";
+    case string_literal:
+        return "string_literal";
+    case basic_type:
+        return "basic_type";
+    case array_type:
+        return "array_type";
+    case pointer_type:
+        return "pointer_type";
+    }
+
+    return "unknown";
+}
+
+/// Records every node in source order, then continues the recursive walk.
+class QueryEngine::Indexer : public RecursiveNodeVisitor {
+  public:
+    explicit Indexer(QueryEngine *engine) : engine_(engine) {}
+
+    void visit(Program &p) override
+    {
+        engine_->add(p, NodeKind::program);
+        RecursiveNodeVisitor::visit(p);
+    }
+
+    void visit(VariableDeclaration &vd) override
+    {
+        engine_->add(vd, NodeKind::variable_declaration);
+        if (auto const &type = vd.declared_type()) {
+            type->accept(*this);
+        }
+        RecursiveNodeVisitor::visit(vd);
+    }
+
+    void visit(FunctionDeclaration &fd) override
+    {
+        engine_->add(fd, NodeKind::function_declaration);
+        for (auto const &param : fd.parameters()) {
+            param.type->accept(*this);
+        }
+        if (auto const &type = fd.return_type()) {
+            type->accept(*this);
+        }
+        RecursiveNodeVisitor::visit(fd);
+    }
+
+    void visit(CompoundStatement &cs) override
+    {
+        engine_->add(cs, NodeKind::compound_statement);
+        RecursiveNodeVisitor::visit(cs);
+    }
+
+    void visit(DeclarationStatement &ds) override
+    {
+        engine_->add(ds, NodeKind::declaration_statement);
+        RecursiveNodeVisitor::visit(ds);
+    }
+
+    void visit(ExpressionStatement &es) override
+    {
+        engine_->add(es, NodeKind::expression_statement);
+        RecursiveNodeVisitor::visit(es);
+    }
+
+    void visit(ReturnStatement &rs) override
+    {
+        engine_->add(rs, NodeKind::return_statement);
+        RecursiveNodeVisitor::visit(rs);
+    }
+
+    void visit(IfStatement &is) override
+    {
+        engine_->add(is, NodeKind::if_statement);
+        RecursiveNodeVisitor::visit(is);
+    }
+
+    void visit(WhileStatement &ws) override
+    {
+        engine_->add(ws, NodeKind::while_statement);
+        RecursiveNodeVisitor::visit(ws);
+    }
+
+    void visit(CallExpression &ce) override
+    {
+        engine_->add(ce, NodeKind::call_expression);
+        RecursiveNodeVisitor::visit(ce);
+    }
+
+    void visit(UnaryExpression &ue) override
+    {
+        engine_->add(ue, NodeKind::unary_expression);
+        RecursiveNodeVisitor::visit(ue);
+    }
+
+    void visit(BinaryExpression &be) override
+    {
+        engine_->add(be, NodeKind::binary_expression);
+        RecursiveNodeVisitor::visit(be);
+    }
+
+    void visit(IdentifierExpression &ie) override
+    {
+        engine_->add(ie, NodeKind::identifier_expression);
+    }
+
+    void visit(IntegerLiteralExpr &ie) override
+    {
+        engine_->add(ie, NodeKind::integer_literal);
+    }
+
+    void visit(FloatLiteralExpr &fe) override
+    {
+        engine_->add(fe, NodeKind::float_literal);
+    }
+
+    void visit(StringLiteralExpr &se) override
+    {
+        engine_->add(se, NodeKind::string_literal);
+    }
+
+    void visit(IndexExpression &ie) override
+    {
+        engine_->add(ie, NodeKind::index_expression);
+        RecursiveNodeVisitor::visit(ie);
+    }
+
+    void visit(BasicType &bt) override
+    {
+        engine_->add(bt, NodeKind::basic_type);
+    }
+
+    void visit(ArrayType &at) override
+    {
+        engine_->add(at, NodeKind::array_type);
+        RecursiveNodeVisitor::visit(at);
+    }
+
+    void visit(PointerType &pt) override
+    {
+        engine_->add(pt, NodeKind::pointer_type);
+        RecursiveNodeVisitor::visit(pt);
+    }
+
+  private:
+    QueryEngine *engine_;
+};
+
+QueryEngine::QueryEngine(Program &prog)
+{
+    Indexer indexer(this);
+    prog.accept(indexer);
+}
+
+void QueryEngine::add(Node &node, NodeKind kind)
+{
+    by_kind_[kind].push_back(&node);
+    if (auto op = operator_of(node, kind)) {
+        by_operator_[{kind, std::string{*op}}].push_back(&node);
+    }
+    if (auto *sym = referenced_symbol(node, kind)) {
+        by_symbol_[{kind, sym}].push_back(&node);
+    }
+}
+
+std::vector<Node *> QueryEngine::query(Matcher const &m) const
+{
+    // Starts from the most selective index available
+    std::span<Node *const> candidates;
+    if (m.symbol != nullptr) {
+        if (auto it = by_symbol_.find({m.kind, m.symbol});
+            it != by_symbol_.end()) {
+            candidates = it->second;
+        }
+    }
+    else if (m.op.has_value()) {
+        if (auto it = by_operator_.find({m.kind, *m.op});
+            it != by_operator_.end()) {
+            candidates = it->second;
+        }
+    }
+    else {
+        candidates = nodes_of(m.kind);
+    }
+
+    std::vector<Node *> result;
+    for (auto *node : candidates) {
+        if (m.op.has_value() && operator_of(*node, m.kind) != *m.op) {
+            continue;
+        }
+        if (m.where && !m.where(*node)) {
+            continue;
+        }
+        result.push_back(node);
+    }
+    return result;
+}
+
+std::span<Node *const> QueryEngine::nodes_of(NodeKind kind) const
+{
+    if (auto it = by_kind_.find(kind); it != by_kind_.end()) {
+        return it->second;
+    }
+    return {};
+}
+
+semantic::Symbol *QueryEngine::referenced_symbol(Node &node, NodeKind kind)
+{
+    switch (kind) {
+    case NodeKind::variable_declaration:
+    case NodeKind::function_declaration:
+        return static_cast<Declaration &>(node).symbol();
+    case NodeKind::identifier_expression:
+        return static_cast<IdentifierExpression &>(node).symbol();
+    case NodeKind::call_expression:
+        return static_cast<CallExpression &>(node).callee()->symbol();
+    case NodeKind::index_expression: {
+        // The symbol of the innermost base, e.g. `a` in `a[1][2]`
+        auto *base = static_cast<IndexExpression &>(node).base().get();
+        while (auto *ie = dynamic_cast<IndexExpression *>(base)) {
+            base = ie->base().get();
+        }
+        return base->symbol();
+    }
+    default:
+        return nullptr;
+    }
+}
+
+std::optional<std::string_view> QueryEngine::operator_of(Node &node,
+                                                         NodeKind kind)
+{
+    switch (kind) {
+    case NodeKind::unary_expression:
+        return static_cast<UnaryExpression &>(node).op();
+    case NodeKind::binary_expression:
+        return static_cast<BinaryExpression &>(node).op().value;
+    default:
+        return std::nullopt;
+    }
+}
+
+} // namespace ast
@@ -0,0 +1,118 @@
+#pragma once
+#include <ast/ast.h>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ast {
+
+enum class NodeKind : unsigned char {
+    program,
+
+    variable_declaration,
+    function_declaration,
+
+    compound_statement,
+    declaration_statement,
+    expression_statement,
+    return_statement,
+    if_statement,
+    while_statement,
+
+    identifier_expression,
+    unary_expression,
+    binary_expression,
+    call_expression,
+    index_expression,
+    integer_literal,
+    float_literal,
+    string_literal,
+
+    basic_type,
+    array_type,
+    pointer_type,
+};
+
+std::string_view to_string(NodeKind kind) noexcept;
+
+/// @brief Declarative description of the nodes a query selects. Unset fields
+/// match anything.
+///
+/// - `op` is the operator spelling of a unary or binary expression.
+/// - `symbol` is the symbol a node refers to: the resolved symbol of an
+///   identifier, the callee of a call, the base of an index expression or the
+///   symbol introduced by a declaration.
+/// - `where` is an arbitrary predicate, applied last.
+struct Matcher {
+    NodeKind kind;
+    std::optional<std::string> op;
+    semantic::Symbol *symbol{};
+    std::function<bool(Node &)> where;
+};
+
+/// @brief Per-kind, per-operator and per-symbol indexes over an analyzed
+/// program.
+///
+/// The indexes are built once, after semantic analysis, so that a query only
+/// touches the nodes of its most selective index instead of walking the whole
+/// tree. Rebuild the engine if the tree is modified.
+class QueryEngine {
+  public:
+    explicit QueryEngine(Program &prog);
+
+    [[nodiscard]] std::vector<Node *> query(Matcher const &m) const;
+
+    template <typename T>
+    [[nodiscard]] std::vector<T *> query_as(Matcher const &m) const
+    {
+        std::vector<T *> result;
+        for (auto *node : query(m)) {
+            result.push_back(static_cast<T *>(node));
+        }
+        return result;
+    }
+
+    /// @brief All nodes of the given kind, in source order.
+    [[nodiscard]] std::span<Node *const> nodes_of(NodeKind kind) const;
+
+    /// @brief The symbol a node refers to, as used by `Matcher::symbol`.
+    static semantic::Symbol *referenced_symbol(Node &node, NodeKind kind);
+
+    /// @brief The operator spelling of a node, as used by `Matcher::op`.
+    static std::optional<std::string_view> operator_of(Node &node,
+                                                       NodeKind kind);
+
+  private:
+    class Indexer;
+
+    template <typename Key> struct KindKey {
+        NodeKind kind;
+        Key key;
+
+        bool operator==(KindKey const &) const = default;
+    };
+
+    template <typename Key> struct KindKeyHash {
+        std::size_t operator()(KindKey<Key> const &k) const noexcept
+        {
+            return std::hash<Key>{}(k.key) * 31 +
+                   static_cast<std::size_t>(k.kind);
+        }
+    };
+
+    void add(Node &node, NodeKind kind);
+
+    std::unordered_map<NodeKind, std::vector<Node *>> by_kind_;
+    std::unordered_map<KindKey<std::string>, std::vector<Node *>,
+                       KindKeyHash<std::string>>
+        by_operator_;
+    std::unordered_map<KindKey<semantic::Symbol *>, std::vector<Node *>,
+                       KindKeyHash<semantic::Symbol *>>
+        by_symbol_;
+};
+
+} // namespace ast
@@ -1,6 +1,7 @@
 #include <ast/stmt.h>
 
 #include <ast/node-visitor.h>
+#include <utility>
 
 void ast::EmptyStatement::dump(std::ostream &os, int indent) const
 {
@@ -87,16 +88,37 @@ void ast::ReturnStatement::accept(NodeVisitor &v)
     v.visit(*this);
 }
 
+std::unique_ptr<ast::Expression>
+ast::ReturnStatement::replace_child(Expression const &child,
+                                    std::unique_ptr<Expression> replacement)
+{
+    return replace_in({&returned_value_}, child, std::move(replacement));
+}
+
 void ast::ExpressionStatement::accept(NodeVisitor &v)
 {
     v.visit(*this);
 }
 
+std::unique_ptr<ast::Expression>
+ast::ExpressionStatement::replace_child(Expression const &child,
+                                        std::unique_ptr<Expression> replacement)
+{
+    return replace_in({&expr_}, child, std::move(replacement));
+}
+
 void ast::IfStatement::accept(NodeVisitor &v)
 {
     v.visit(*this);
 }
 
+std::unique_ptr<ast::Expression>
+ast::IfStatement::replace_child(Expression const &child,
+                                std::unique_ptr<Expression> replacement)
+{
+    return replace_in({&condition_}, child, std::move(replacement));
+}
+
 void ast::WhileStatement::dump(std::ostream &os, int indent) const
 {
     make_indent(os, indent);
@@ -124,3 +146,10 @@ void ast::WhileStatement::accept(NodeVisitor &v)
 {
     v.visit(*this);
 }
+
+std::unique_ptr<ast::Expression>
+ast::WhileStatement::replace_child(Expression const &child,
+                                   std::unique_ptr<Expression> replacement)
+{
+    return replace_in({&condition_}, child, std::move(replacement));
+}
@@ -49,6 +49,10 @@ class ReturnStatement : public Statement {
 
     void accept(NodeVisitor &v) override;
 
+    std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement) override;
+
     [[nodiscard]] ExpressionPtr const &returned_value() const
     {
         return returned_value_;
@@ -66,6 +70,10 @@ class IfStatement : public Statement {
 
     void accept(NodeVisitor &v) override;
 
+    std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement) override;
+
     [[nodiscard]] ExpressionPtr const &condition() const
     {
         return condition_;
@@ -95,6 +103,10 @@ class WhileStatement : public Statement {
 
     void accept(NodeVisitor &v) override;
 
+    std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement) override;
+
     [[nodiscard]] ExpressionPtr const &condition() const
     {
         return condition_;
@@ -135,6 +147,10 @@ class ExpressionStatement : public Statement {
 
     void accept(NodeVisitor &v) override;
 
+    std::unique_ptr<Expression>
+    replace_child(Expression const &child,
+                  std::unique_ptr<Expression> replacement) override;
+
     [[nodiscard]] std::unique_ptr<Expression> const &expr() const
     {
         return expr_;
@@ -1,15 +1,61 @@
 #pragma once
+#include <atomic>
+#include <mutex>
 #include <print>
+#include <string>
 #include <utility>
+#include <vector>
 
+/// @brief Error sink shared by every compiler phase.
+///
+/// Reporting is thread-safe. A buffered sink keeps its messages instead of
+/// printing them, so that per-function workers can report concurrently and be
+/// flushed into the main sink later in a deterministic order.
 class Diagnostics {
   public:
+    enum class Mode : unsigned char {
+        immediate,
+        buffered,
+    };
+
+    Diagnostics() = default;
+    explicit Diagnostics(Mode mode) : mode_(mode) {}
+
     template <typename... Ts>
     void error(std::format_string<Ts...> fmt, Ts &&...ts)
     {
-        std::print("error: ");
-        std::println(fmt, std::forward<Ts>(ts)...);
+        report(std::format(fmt, std::forward<Ts>(ts)...));
+    }
+
+    void report(std::string message)
+    {
+        std::scoped_lock lock(mutex_);
         has_error_ = true;
+        if (mode_ == Mode::buffered) {
+            messages_.push_back(std::move(message));
+            return;
+        }
+        std::println("error: {}", message);
+    }
+
+    /// @brief Moves all buffered messages into `sink`, keeping their order.
+    void flush_into(Diagnostics &sink)
+    {
+        std::vector<std::string> messages;
+        {
+            std::scoped_lock lock(mutex_);
+            messages.swap(messages_);
+        }
+        for (auto &message : messages) {
+            sink.report(std::move(message));
+        }
+    }
+
+    /// @brief Removes and returns all buffered messages.
+    std::vector<std::string> take_messages()
+    {
+        std::scoped_lock lock(mutex_);
+        return std::exchange(messages_, {});
     }
 
     [[nodiscard]] bool has_error() const
@@ -17,6 +63,15 @@ class Diagnostics {
         return has_error_;
     }
 
+    /// @brief Returns whether an error was reported, and clears the flag.
+    bool consume_error()
+    {
+        return has_error_.exchange(false);
+    }
+
   private:
-    bool has_error_{};
+    Mode mode_{Mode::immediate};
+    std::atomic<bool> has_error_{};
+    std::mutex mutex_;
+    std::vector<std::string> messages_;
 };
@@ -0,0 +1,250 @@
+#include <charconv>
+#include <diagnostics.h>
+#include <fstream>
+#include <iostream>
+#include <ir/ir-builder.h>
+#include <ir/ir-interpreter.h>
+#include <jit/jit.h>
+#include <lex/lexer.h>
+#include <optional>
+#include <parser/parser.h>
+#include <print>
+#include <semantic/constant-evaluator.h>
+#include <semantic/context.h>
+#include <semantic/continuation-interpreter.h>
+#include <semantic/intepreter.h>
+#include <semantic/memoizer.h>
+#include <semantic/profiler.h>
+#include <semantic/sampling-profiler.h>
+#include <semantic/semantic-analyzer.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <trace/trace.h>
+#include <vm/compiler.h>
+#include <vm/vm.h>
+
+namespace {
+
+void usage()
+{
+    std::println(std::cerr,
+                 "Usage: hlvm [--engine=vm|tree|ir|stackless] [--jit] "
+                 "[--dump-bytecode] [--no-bounds-checks] [--no-fold] "
+                 "[--max-depth=<n>] [--trace=<output>] [--profile] "
+                 "[--profile-folded=<output>] [--sample] "
+                 "[--sample-folded=<output>] [--memoize] <file>");
+}
+
+} // namespace
+
+// Runs a program and prints what its 'main' returns. Calls of pure functions
+// on constants are folded first, unless --no-fold. The bytecode VM is the
+// default engine, whose integer-only functions --jit compiles to native
+// code; the tree-walking interpreter is kept as a reference, and the IR
+// executor runs integer programs from the lowered IR. The stackless engine
+// walks the tree without native recursion, for calls nested up to
+// --max-depth deep. Tracing, profiling, sampling and memoization cover the
+// tree walker, which they select.
+int main(int argc, char **argv)
+{
+    std::string_view engine = "vm";
+    bool use_jit{};
+    bool dump_bytecode{};
+    bool bounds_checks{true};
+    bool fold{true};
+    std::string_view trace_path;
+    bool profile{};
+    std::string_view folded_path;
+    bool sample{};
+    std::string_view sample_folded_path;
+    bool memoize{};
+    auto max_depth = semantic::ContinuationInterpreter::default_max_depth;
+    char const *path{};
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--engine=")) {
+            engine = arg.substr(arg.find('=') + 1);
+        }
+        else if (arg == "--jit") {
+            use_jit = true;
+        }
+        else if (arg == "--dump-bytecode") {
+            dump_bytecode = true;
+        }
+        else if (arg == "--no-fold") {
+            fold = false;
+        }
+        else if (arg == "--no-bounds-checks") {
+            bounds_checks = false;
+        }
+        else if (arg.starts_with("--trace=")) {
+            trace_path = arg.substr(arg.find('=') + 1);
+        }
+        else if (arg == "--profile") {
+            profile = true;
+        }
+        else if (arg.starts_with("--profile-folded=")) {
+            folded_path = arg.substr(arg.find('=') + 1);
+        }
+        else if (arg == "--sample") {
+            sample = true;
+        }
+        else if (arg.starts_with("--sample-folded=")) {
+            sample_folded_path = arg.substr(arg.find('=') + 1);
+        }
+        else if (arg.starts_with("--max-depth=")) {
+            auto digits = arg.substr(arg.find('=') + 1);
+            auto [end, ec] = std::from_chars(
+                digits.data(), digits.data() + digits.size(), max_depth);
+            if (ec != std::errc{} || end != digits.data() + digits.size()) {
+                usage();
+                return 2;
+            }
+        }
+        else if (arg == "--memoize") {
+            memoize = true;
+        }
+        else if (!arg.starts_with("--") && path == nullptr) {
+            path = argv[i];
+        }
+        else {
+            usage();
+            return 2;
+        }
+    }
+    bool sampling = sample || !sample_folded_path.empty();
+    if (!trace_path.empty() || profile || !folded_path.empty() || sampling ||
+        memoize) {
+        engine = "tree";
+    }
+    if (path == nullptr ||
+        (engine != "vm" && engine != "tree" && engine != "ir" &&
+         engine != "stackless")) {
+        usage();
+        return 2;
+    }
+
+    if (use_jit && !jit::supported) {
+        std::println(std::cerr, "The JIT only supports x86-64 Linux");
+        return 2;
+    }
+#if !HLVM_TRACE
+    if (!trace_path.empty()) {
+        std::println(std::cerr, "hlvm was built without HLVM_TRACE");
+        return 2;
+    }
+#endif
+
+    Lexer lexer(path);
+    Diagnostics diags;
+    Parser parser(&lexer, &diags);
+    auto prog = parser.parse_program();
+    if (!prog || diags.has_error()) {
+        return 1;
+    }
+
+    semantic::Context ctx;
+    semantic::SemanticAnalyzer analyzer(&ctx, &diags);
+    prog->accept(analyzer);
+    if (diags.has_error()) {
+        return 1;
+    }
+    if (fold) {
+        semantic::ConstantEvaluator evaluator;
+        prog->accept(evaluator);
+    }
+
+    std::optional<semantic::Value> result;
+    if (engine == "tree") {
+        trace::RingBuffer buffer;
+        std::optional<trace::Session> session;
+        if (!trace_path.empty()) {
+            session.emplace(&buffer);
+        }
+        semantic::Profiler profiler;
+        semantic::Intepreter inte(&ctx, &diags);
+        if (profile || !folded_path.empty()) {
+            inte.set_profiler(&profiler);
+        }
+        std::optional<semantic::Memoizer> memoizer;
+        if (memoize) {
+            memoizer.emplace(*prog);
+            inte.set_memoizer(&*memoizer);
+        }
+        std::optional<semantic::SamplingProfiler> sampler;
+        if (sampling) {
+            sampler.emplace();
+            inte.set_sampler(&*sampler);
+            sampler->start();
+        }
+        prog->accept(inte);
+        if (sampler) {
+            sampler->stop();
+        }
+        result = inte.last_returned();
+        if (!trace_path.empty()) {
+            std::ofstream ofs(std::string{trace_path}, std::ios::binary);
+            buffer.write_to(ofs);
+        }
+        if (profile) {
+            profiler.report(std::cerr);
+            if (memoizer) {
+                std::println(std::cerr);
+                memoizer->report(std::cerr);
+            }
+        }
+        if (!folded_path.empty()) {
+            std::ofstream ofs{std::string{folded_path}};
+            profiler.write_folded(ofs);
+        }
+        if (sample) {
+            sampler->report(std::cerr);
+        }
+        if (!sample_folded_path.empty()) {
+            std::ofstream ofs{std::string{sample_folded_path}};
+            sampler->write_folded(ofs);
+        }
+    }
+    else if (engine == "stackless") {
+        semantic::ContinuationInterpreter inte(&diags, max_depth);
+        result = inte.run(*prog);
+    }
+    else if (engine == "ir") {
+        ir::IRBuilder builder;
+        try {
+            prog->accept(builder);
+        }
+        catch (std::runtime_error const &e) {
+            // What integer IR can't express
+            diags.error("{}", e.what());
+            return 1;
+        }
+        ir::IRInterpreter executor(&diags);
+        if (auto value = executor.run(builder.instructions())) {
+            result = semantic::Value{*value};
+        }
+    }
+    else {
+        vm::Compiler compiler(&diags);
+        compiler.set_bounds_checks(bounds_checks);
+        auto module = compiler.compile(*prog);
+        if (diags.has_error()) {
+            return 1;
+        }
+        if (dump_bytecode) {
+            module.dump(std::cout);
+        }
+        jit::Code code;
+        vm::VM machine(&diags);
+        if (use_jit) {
+            code = jit::Compiler{}.compile(module);
+            machine.set_jit(&code);
+        }
+        result = machine.run(module);
+    }
+    if (diags.has_error() || !result.has_value()) {
+        return 1;
+    }
+    std::println("{}", result->to_string());
+}
@@ -1,16 +1,69 @@
 #include <ast/ast.h>
+#include <ast/parallel-function-visitor.h>
+#include <ast/query.h>
+#include <cstdint>
 #include <determinstic-finite-automaton.h>
 #include <grammar.h>
 #include <gtest/gtest.h>
 #include <ir/ir-builder.h>
+#include <ir/ir-interpreter.h>
+#include <jit/jit.h>
 #include <lex/lexer.h>
+#include <map>
+#include <memory>
 #include <nondeterminstic-finite-automaton.h>
 #include <parser/parser.h>
 #include <print>
+#include <semantic/constant-evaluator.h>
 #include <semantic/context.h>
+#include <semantic/continuation-interpreter.h>
+#include <semantic/escape.h>
+#include <semantic/incremental-analyzer.h>
 #include <semantic/intepreter.h>
+#include <semantic/memoizer.h>
+#include <semantic/profiler.h>
+#include <semantic/sampling-profiler.h>
 #include <semantic/semantic-analyzer.h>
 #include <spdlog/spdlog.h>
+#include <sstream>
+#include <trace/trace.h>
+#include <utility>
+#include <vm/compiler.h>
+#include <vm/vm.h>
+
+namespace {
+
+/// The programs every engine runs, with what their 'main' returns
+constexpr std::pair<char const *, std::int64_t> programs[] = {
+    {"test/functions.hlvm", 170}, {"test/scopes.hlvm", 20},
+    {"test/arrays.hlvm", 42},     {"test/matrices.hlvm", 491},
+    {"test/builtins.hlvm", 3},    {"test/tail-calls.hlvm", 500001},
+    {"test/division.hlvm", 7},    {"test/bare-returns.hlvm", 3},
+    {"test/assignment-order.hlvm", 435}, {"test/overflow.hlvm", 1111},
+    {"test/uninitialized.hlvm", 2},       {"test/running-off.hlvm", 1},
+};
+
+/// Parses and analyzes the program at `path`, on `pool` if any; null if that
+/// fails.
+std::unique_ptr<ast::Program> analyze(char const *path, semantic::Context *ctx,
+                                      Diagnostics *diags,
+                                      ThreadPool *pool = nullptr)
+{
+    Lexer lexer(path);
+    Parser parser(&lexer, diags);
+    auto prog = parser.parse_program();
+    if (!prog || diags->consume_error()) {
+        return nullptr;
+    }
+    semantic::SemanticAnalyzer analyzer(ctx, diags, pool);
+    prog->accept(analyzer);
+    if (diags->consume_error()) {
+        return nullptr;
+    }
+    return prog;
+}
+
+} // namespace
 
 TEST(Automaton, Basic)
 {
@@ -76,6 +129,151 @@ TEST(Semantic, Basic)
     EXPECT_FALSE(diags.consume_error());
 }
 
+TEST(Semantic, Parallel)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    ThreadPool pool(4);
+    auto prog = analyze("test/functions.hlvm", &ctx, &diags, &pool);
+    ASSERT_TRUE(prog);
+
+    ast::QueryEngine engine(*prog);
+    EXPECT_TRUE(engine
+                    .query({.kind = ast::NodeKind::identifier_expression,
+                            .where =
+                                [](ast::Node &node) {
+                                    auto &e = static_cast<ast::Expression &>(
+                                        node);
+                                    return e.symbol() == nullptr ||
+                                           e.type() == nullptr;
+                                }})
+                    .empty());
+}
+
+TEST(Semantic, OpCodes)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/functions.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    ast::QueryEngine engine(*prog);
+    auto opcodes = [&engine](std::string op) {
+        std::vector<semantic::OpCode> result;
+        for (auto *be : engine.query_as<ast::BinaryExpression>(
+                 {.kind = ast::NodeKind::binary_expression, .op = op})) {
+            result.push_back(be->opcode());
+        }
+        return result;
+    };
+    using enum semantic::OpCode;
+    EXPECT_EQ(opcodes("*"), std::vector({int_mul, int_mul, int_mul}));
+    EXPECT_EQ(opcodes("=="), std::vector({int_eq, int_eq}));
+    EXPECT_EQ(opcodes("="), std::vector({assign, assign}));
+    for (auto *ue : engine.query_as<ast::UnaryExpression>(
+             {.kind = ast::NodeKind::unary_expression})) {
+        EXPECT_EQ(ue->opcode(), int_neg);
+    }
+}
+
+TEST(Semantic, ConstantEvaluation)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/functions.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    // Only `f(10)` has constant arguments
+    semantic::ConstantEvaluator evaluator;
+    prog->accept(evaluator);
+    EXPECT_EQ(evaluator.stats().folded, 1);
+    EXPECT_EQ(evaluator.stats().evaluated, 11); // f(0) to f(10), once each
+
+    ast::QueryEngine engine(*prog);
+    auto literals = engine.query_as<ast::IntegerLiteralExpr>(
+        {.kind = ast::NodeKind::integer_literal});
+    EXPECT_TRUE(std::ranges::any_of(
+        literals, [](auto *literal) { return literal->value() == 89; }));
+
+    // A budget too small leaves the call alone
+    semantic::Context ctx2;
+    auto prog2 = analyze("test/functions.hlvm", &ctx2, &diags);
+    ASSERT_TRUE(prog2);
+    semantic::ConstantEvaluator limited(100);
+    prog2->accept(limited);
+    EXPECT_EQ(limited.stats().folded, 0);
+    EXPECT_FALSE(diags.consume_error());
+}
+
+TEST(Semantic, Incremental)
+{
+    Diagnostics diags;
+
+    auto parse = [&diags] {
+        Lexer lexer("test/functions.hlvm");
+        Parser parser(&lexer, &diags);
+        return parser.parse_program();
+    };
+    auto prog = parse();
+    ASSERT_FALSE(diags.consume_error());
+    ASSERT_TRUE(prog);
+
+    semantic::IncrementalAnalyzer analyzer;
+    analyzer.analyze(*prog, &diags);
+    EXPECT_FALSE(diags.consume_error());
+    auto const first = analyzer.stats().executed;
+
+    // Nothing changed
+    analyzer.analyze(*prog, &diags);
+    EXPECT_FALSE(diags.consume_error());
+    EXPECT_EQ(analyzer.stats().executed, first);
+
+    // Edits `add`, keeping its signature: only its own queries rerun
+    auto edited = parse();
+    prog->replace_declaration(1, edited->replace_declaration(1, nullptr));
+    analyzer.analyze(*prog, &diags);
+    EXPECT_FALSE(diags.consume_error());
+    EXPECT_EQ(analyzer.stats().executed, first + 2);
+
+    semantic::Intepreter inte(analyzer.context(), &diags);
+    prog->accept(inte);
+    EXPECT_FALSE(diags.consume_error());
+}
+
+TEST(Semantic, IncrementalEdits)
+{
+    Diagnostics diags;
+
+    auto parse = [&diags] {
+        Lexer lexer("test/scopes.hlvm");
+        Parser parser(&lexer, &diags);
+        return parser.parse_program();
+    };
+    auto prog = parse();
+    ASSERT_FALSE(diags.consume_error());
+    ASSERT_TRUE(prog);
+
+    semantic::IncrementalAnalyzer analyzer;
+    analyzer.analyze(*prog, &diags);
+    EXPECT_FALSE(diags.consume_error());
+
+    // Each edit of `shadow` drops the context its body was checked in, whose
+    // scopes hang off the global scope
+    for (int i = 0; i < 2; ++i) {
+        auto edited = parse();
+        prog->replace_declaration(2, edited->replace_declaration(2, nullptr));
+        analyzer.analyze(*prog, &diags);
+        EXPECT_FALSE(diags.consume_error());
+    }
+    analyzer.context()->dump(0);
+
+    semantic::Intepreter inte(analyzer.context(), &diags);
+    prog->accept(inte);
+    EXPECT_FALSE(diags.consume_error());
+    ASSERT_TRUE(inte.last_returned().has_value());
+    EXPECT_EQ(inte.last_returned()->as_int(), 20);
+}
+
 TEST(Intepreter, Basic)
 {
     Lexer lexer("system64.hlvm");
@@ -99,6 +297,416 @@ TEST(Intepreter, Basic)
     EXPECT_FALSE(diags.consume_error());
 }
 
+TEST(Intepreter, Functions)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/functions.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    semantic::Intepreter inte(&ctx, &diags);
+    prog->accept(inte);
+    EXPECT_FALSE(diags.consume_error());
+    ASSERT_TRUE(inte.last_returned().has_value());
+    EXPECT_EQ(inte.last_returned()->as_int(), 170);
+}
+
+TEST(Intepreter, Scopes)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/scopes.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+    EXPECT_EQ(prog->global_frame_size(), 1);
+
+    semantic::Intepreter inte(&ctx, &diags);
+    prog->accept(inte);
+    EXPECT_FALSE(diags.consume_error());
+    ASSERT_TRUE(inte.last_returned().has_value());
+    EXPECT_EQ(inte.last_returned()->as_int(), 20);
+}
+
+TEST(Intepreter, Programs)
+{
+    for (auto [path, expected] : programs) {
+        Diagnostics diags;
+        semantic::Context ctx;
+        auto prog = analyze(path, &ctx, &diags);
+        ASSERT_TRUE(prog) << path;
+
+        semantic::Intepreter inte(&ctx, &diags);
+        prog->accept(inte);
+        EXPECT_FALSE(diags.consume_error());
+        ASSERT_TRUE(inte.last_returned().has_value()) << path;
+        EXPECT_EQ(inte.last_returned()->as_int(), expected) << path;
+    }
+}
+
+TEST(VM, Programs)
+{
+    for (auto [path, expected] : programs) {
+        Diagnostics diags;
+        semantic::Context ctx;
+        auto prog = analyze(path, &ctx, &diags);
+        ASSERT_TRUE(prog) << path;
+
+        vm::Compiler compiler(&diags);
+        auto module = compiler.compile(*prog);
+        ASSERT_FALSE(diags.consume_error());
+        vm::VM machine(&diags);
+        auto result = machine.run(module);
+        EXPECT_FALSE(diags.consume_error());
+        ASSERT_TRUE(result.has_value()) << path;
+        EXPECT_EQ(result->as_int(), expected) << path;
+    }
+}
+
+TEST(VM, BoundsChecks)
+{
+    Diagnostics diags(Diagnostics::Mode::buffered);
+    semantic::Context ctx;
+    auto prog = analyze("test/out-of-bounds.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    semantic::Intepreter inte(&ctx, &diags);
+    prog->accept(inte);
+    EXPECT_TRUE(diags.consume_error());
+
+    vm::Compiler compiler(&diags);
+    auto module = compiler.compile(*prog);
+    ASSERT_FALSE(diags.consume_error());
+    vm::VM machine(&diags);
+    EXPECT_FALSE(machine.run(module).has_value());
+    EXPECT_TRUE(diags.consume_error());
+
+    auto messages = diags.take_messages();
+    ASSERT_EQ(messages.size(), 2);
+    EXPECT_NE(messages[0].find("Index 3 out of bounds"), std::string::npos);
+    EXPECT_NE(messages[1].find("Index 3 out of bounds"), std::string::npos);
+}
+
+TEST(Intepreter, BoundsChecks)
+{
+    Diagnostics diags(Diagnostics::Mode::buffered);
+    semantic::Context ctx;
+    auto prog = analyze("test/out-of-bounds-store.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    semantic::Intepreter inte(&ctx, &diags);
+    prog->accept(inte);
+    EXPECT_TRUE(diags.consume_error());
+    EXPECT_FALSE(inte.last_returned().has_value());
+
+    auto messages = diags.take_messages();
+    ASSERT_EQ(messages.size(), 1);
+    EXPECT_NE(messages[0].find("Index 3 out of bounds"), std::string::npos);
+}
+
+TEST(JIT, Programs)
+{
+    if (!jit::supported) {
+        GTEST_SKIP() << "The JIT only supports x86-64 Linux";
+    }
+    for (auto [path, expected] : programs) {
+        Diagnostics diags;
+        semantic::Context ctx;
+        auto prog = analyze(path, &ctx, &diags);
+        ASSERT_TRUE(prog) << path;
+
+        vm::Compiler compiler(&diags);
+        auto module = compiler.compile(*prog);
+        ASSERT_FALSE(diags.consume_error());
+        auto code = jit::Compiler{}.compile(module);
+        vm::VM machine(&diags);
+        machine.set_jit(&code);
+        auto result = machine.run(module);
+        EXPECT_FALSE(diags.consume_error());
+        ASSERT_TRUE(result.has_value()) << path;
+        EXPECT_EQ(result->as_int(), expected) << path;
+        if (std::string_view{path} == "test/functions.hlvm") {
+            EXPECT_EQ(code.compiled(), 4); // <entry>, main, add and f
+        }
+    }
+}
+
+TEST(EscapeAnalysis, FrameArrays)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/array-lifetimes.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    // Only `a` of local and `row` of main die with their frame
+    std::map<std::string, std::size_t> frame_arrays;
+    for (auto *fd : ast::function_declarations(*prog)) {
+        frame_arrays[fd->name()] = fd->frame_arrays().size();
+    }
+    EXPECT_EQ(frame_arrays, (std::map<std::string, std::size_t>{
+                                {"fill", 0}, {"keep", 0}, {"local", 1},
+                                {"main", 1}}));
+    semantic::EscapeAnalysis escapes(*prog);
+    for (auto *fd : ast::function_declarations(*prog)) {
+        auto const *param = fd->parameters().empty()
+                                ? nullptr
+                                : fd->parameters().front().symbol;
+        if (fd->name() == "fill") {
+            EXPECT_FALSE(escapes.escapes(param));
+        }
+        else if (fd->name() == "keep") {
+            EXPECT_TRUE(escapes.escapes(param));
+        }
+    }
+
+    semantic::Intepreter inte(&ctx, &diags);
+    prog->accept(inte);
+    EXPECT_FALSE(diags.consume_error());
+    ASSERT_TRUE(inte.last_returned().has_value());
+    EXPECT_EQ(inte.last_returned()->as_int(), 3001);
+
+    // Released storage is reused
+    semantic::ArrayPool pool;
+    std::size_t const lengths[] = {3, 2};
+    auto *array = pool.make(lengths);
+    semantic::Value value{array};
+    pool.release(value);
+    EXPECT_EQ(value.kind(), semantic::Value::Kind::none);
+    EXPECT_EQ(pool.live(), 0);
+    EXPECT_EQ(pool.make(lengths), array);
+    EXPECT_EQ(pool.live(), 1);
+}
+
+TEST(Trace, RingBuffer)
+{
+    trace::RingBuffer buffer(3); // Rounded up to 4
+    for (std::int64_t i = 0; i < 6; ++i) {
+        buffer.write(trace::make_record(trace::Event::statement, {}, i));
+    }
+    auto records = buffer.snapshot();
+    ASSERT_EQ(records.size(), 4);
+    EXPECT_EQ(records.front().value, 2);
+    EXPECT_EQ(records.back().value, 5);
+    EXPECT_EQ(buffer.written(), 6);
+
+#if HLVM_TRACE
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/functions.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    trace::RingBuffer program_buffer;
+    {
+        trace::Session session(&program_buffer);
+        semantic::Intepreter inte(&ctx, &diags);
+        prog->accept(inte);
+    }
+    auto iterations = std::ranges::count_if(
+        program_buffer.snapshot(), [](trace::Record const &r) {
+            return r.event == trace::Event::loop_iteration;
+        });
+    EXPECT_EQ(iterations, 5);
+#endif
+}
+
+TEST(Profiler, Functions)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/functions.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    semantic::Profiler profiler;
+    semantic::Intepreter inte(&ctx, &diags);
+    inte.set_profiler(&profiler);
+    prog->accept(inte);
+    ASSERT_FALSE(diags.consume_error());
+
+    auto fds = ast::function_declarations(*prog);
+    auto find = [&](std::string_view name) {
+        return *std::ranges::find(fds, name, &ast::FunctionDeclaration::name);
+    };
+    auto const main = profiler.function_stats(find("main"));
+    auto const f = profiler.function_stats(find("f"));
+    EXPECT_EQ(main.calls, 1);
+    EXPECT_EQ(f.calls, 177); // fib(10), naively
+    EXPECT_EQ(profiler.function_stats(find("add")).calls, 1);
+    EXPECT_GE(main.inclusive, f.inclusive);
+    EXPECT_LE(f.exclusive, f.inclusive);
+
+    auto const *loop = dynamic_cast<ast::WhileStatement *>(
+        find("main")->body()->statements()[7].get());
+    ASSERT_NE(loop, nullptr);
+    EXPECT_EQ(profiler.iteration_count(loop), 5);
+    EXPECT_EQ(profiler.statement_count(loop), 1);
+
+    std::ostringstream report;
+    profiler.report(report);
+    EXPECT_NE(report.str().find("177"), std::string::npos);
+}
+
+TEST(SamplingProfiler, Functions)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/functions.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    semantic::SamplingProfiler sampler(std::chrono::microseconds{20});
+    semantic::Intepreter inte(&ctx, &diags);
+    inte.set_sampler(&sampler);
+    sampler.start();
+    // Runs until some CPU time has been sampled
+    for (int i = 0; i != 10000 && sampler.samples().size() < 10; ++i) {
+        prog->accept(inte);
+    }
+    sampler.stop();
+    ASSERT_FALSE(diags.consume_error());
+
+    auto samples = sampler.samples();
+    ASSERT_FALSE(samples.empty());
+    for (auto const &sample : samples) {
+        auto stack = sampler.call_stack(sample.path);
+        if (!stack.empty()) {
+            EXPECT_EQ(stack.front()->name(), "main");
+        }
+    }
+
+    std::ostringstream folded;
+    sampler.write_folded(folded);
+    std::ostringstream report;
+    sampler.report(report);
+    EXPECT_TRUE(folded.str().starts_with("main"));
+    EXPECT_TRUE(report.str().starts_with(std::format("{} samples",
+                                                     samples.size())));
+}
+
+TEST(Memoizer, Functions)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/functions.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    auto fds = ast::function_declarations(*prog);
+    auto find = [&](std::string_view name) {
+        return *std::ranges::find(fds, name, &ast::FunctionDeclaration::name);
+    };
+
+    semantic::Memoizer memoizer(*prog);
+    semantic::Profiler profiler;
+    semantic::Intepreter inte(&ctx, &diags);
+    inte.set_memoizer(&memoizer);
+    inte.set_profiler(&profiler);
+    prog->accept(inte);
+    ASSERT_FALSE(diags.consume_error());
+    ASSERT_TRUE(inte.last_returned().has_value());
+    EXPECT_EQ(inte.last_returned()->as_int(), 170);
+
+    // f(0) to f(10) run once each; from f(3) on, f(n - 2) was cached by
+    // f(n - 1)
+    auto const &f = memoizer.stats(find("f"));
+    EXPECT_EQ(f.misses, 11);
+    EXPECT_EQ(f.hits, 8);
+    EXPECT_EQ(f.evictions, 0);
+    EXPECT_EQ(profiler.function_stats(find("f")).calls, 11);
+
+    // Evicting everything but the latest result only costs time
+    semantic::Memoizer tiny(*prog, 1);
+    inte.set_memoizer(&tiny);
+    prog->accept(inte);
+    ASSERT_FALSE(diags.consume_error());
+    EXPECT_EQ(inte.last_returned()->as_int(), 170);
+    EXPECT_GT(tiny.stats(find("f")).evictions, 0);
+
+    std::ostringstream report;
+    memoizer.report(report);
+    EXPECT_NE(report.str().find("f ("), std::string::npos);
+}
+
+TEST(Memoizer, SkipsImpureFunctions)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/builtins.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    semantic::Memoizer memoizer(*prog);
+    for (auto const *fd : ast::function_declarations(*prog)) {
+        EXPECT_FALSE(memoizer.memoizes(fd)) << fd->name(); // Both print
+    }
+}
+
+TEST(ContinuationInterpreter, Programs)
+{
+    for (auto [path, expected] : programs) {
+        Diagnostics diags;
+        semantic::Context ctx;
+        auto prog = analyze(path, &ctx, &diags);
+        ASSERT_TRUE(prog) << path;
+
+        semantic::ContinuationInterpreter stackless(&diags);
+        auto result = stackless.run(*prog);
+        EXPECT_FALSE(diags.consume_error());
+        ASSERT_TRUE(result.has_value()) << path;
+        EXPECT_EQ(result->as_int(), expected) << path;
+    }
+}
+
+TEST(ContinuationInterpreter, DeepRecursion)
+{
+    Diagnostics diags(Diagnostics::Mode::buffered);
+    semantic::Context ctx;
+    auto prog = analyze("test/deep-recursion.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    // A million frames, deeper than the tree walker's native stack allows
+    semantic::ContinuationInterpreter inte(&diags);
+    auto result = inte.run(*prog);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->as_int(), 1000000);
+
+    semantic::ContinuationInterpreter shallow(&diags, 1000);
+    EXPECT_FALSE(shallow.run(*prog).has_value());
+    EXPECT_TRUE(diags.consume_error());
+
+    auto messages = diags.take_messages();
+    ASSERT_EQ(messages.size(), 1);
+    EXPECT_NE(messages[0].find("Stack overflow"), std::string::npos);
+
+    // The frames of the failed run are gone from the next one
+    semantic::Context ctx2;
+    auto prog2 = analyze("test/functions.hlvm", &ctx2, &diags);
+    ASSERT_TRUE(prog2);
+    result = shallow.run(*prog2);
+    EXPECT_FALSE(diags.consume_error());
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->as_int(), 170);
+}
+
+TEST(ContinuationInterpreter, DivisionByZero)
+{
+    Diagnostics diags(Diagnostics::Mode::buffered);
+    semantic::Context ctx;
+    auto prog = analyze("test/division-by-zero.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    semantic::ContinuationInterpreter stackless(&diags);
+    EXPECT_FALSE(stackless.run(*prog).has_value());
+    EXPECT_TRUE(diags.consume_error());
+
+    // The tree walker stops the same way
+    semantic::Intepreter inte(&ctx, &diags);
+    prog->accept(inte);
+    EXPECT_TRUE(diags.consume_error());
+    EXPECT_FALSE(inte.last_returned().has_value());
+
+    auto messages = diags.take_messages();
+    ASSERT_EQ(messages.size(), 2);
+    EXPECT_NE(messages[0].find("3:12-3:16: Division by zero"),
+              std::string::npos);
+    EXPECT_NE(messages[1].find("3:12-3:16: Division by zero"),
+              std::string::npos);
+}
+
 TEST(IRGeneration, Basic)
 {
     Lexer lexer("system64.hlvm");
@@ -122,6 +730,141 @@ TEST(IRGeneration, Basic)
     EXPECT_FALSE(diags.consume_error());
 }
 
+TEST(IRGeneration, RejectsUnsupported)
+{
+    for (auto [path, message] :
+         {std::pair{"test/floats.hlvm", "Doesn't support float literal"},
+          std::pair{"test/float-parameters.hlvm",
+                    "Doesn't support non-integer parameter 'x'"},
+          std::pair{"test/float-results.hlvm",
+                    "Doesn't support non-integer return type of 'half'"},
+          std::pair{"test/arrays.hlvm",
+                    "Doesn't support non-integer variable 'a'"},
+          std::pair{"test/builtins.hlvm", "Doesn't support builtin calls"},
+          std::pair{"test/bare-returns.hlvm",
+                    "Doesn't support returning no value"},
+          std::pair{"test/uninitialized.hlvm",
+                    "Doesn't support uninitialized variable 'x'"},
+          std::pair{"test/running-off.hlvm",
+                    "Doesn't support 'count' running off its end"}}) {
+        Diagnostics diags;
+        semantic::Context ctx;
+        auto prog = analyze(path, &ctx, &diags);
+        ASSERT_TRUE(prog) << path;
+
+        ir::IRBuilder irbuilder;
+        try {
+            prog->accept(irbuilder);
+            ADD_FAILURE() << path << " was lowered";
+        }
+        catch (std::runtime_error const &e) {
+            EXPECT_NE(std::string_view{e.what()}.find(message),
+                      std::string_view::npos)
+                << e.what();
+        }
+    }
+}
+
+TEST(IRInterpreter, Functions)
+{
+    for (auto [path, expected] : {std::pair{"test/functions.hlvm", 170},
+                                  std::pair{"test/scopes.hlvm", 20},
+                                  std::pair{"test/division.hlvm", 7},
+                                  std::pair{"test/assignment-order.hlvm",
+                                            435},
+                                  std::pair{"test/overflow.hlvm", 1111}}) {
+        Diagnostics diags;
+        semantic::Context ctx;
+        auto prog = analyze(path, &ctx, &diags);
+        ASSERT_TRUE(prog) << path;
+
+        ir::IRBuilder irbuilder;
+        prog->accept(irbuilder);
+        ir::IRInterpreter executor(&diags);
+        auto result = executor.run(irbuilder.instructions());
+        EXPECT_FALSE(diags.consume_error());
+        ASSERT_TRUE(result.has_value()) << path;
+        EXPECT_EQ(*result, expected) << path;
+    }
+}
+
+TEST(ParallelFunctionVisitor, Basic)
+{
+    Lexer lexer("system64.hlvm");
+    Diagnostics diags;
+
+    Parser parser(&lexer, &diags);
+
+    auto prog = parser.parse_program();
+    ASSERT_FALSE(diags.consume_error());
+    ASSERT_TRUE(prog);
+
+    struct IdentifierCounter : ast::RecursiveNodeVisitor {
+        explicit IdentifierCounter(Diagnostics *diags) : diags(diags) {}
+
+        void visit(ast::IdentifierExpression &ie) override
+        {
+            ++count;
+            diags->error("{}", ie.name());
+        }
+
+        Diagnostics *diags;
+        std::size_t count{};
+    };
+
+    // Sequential reference
+    std::vector<std::size_t> expected;
+    for (auto *fd : ast::function_declarations(*prog)) {
+        Diagnostics dummy{Diagnostics::Mode::buffered};
+        IdentifierCounter counter(&dummy);
+        fd->accept(counter);
+        expected.push_back(counter.count);
+    }
+
+    ThreadPool pool(4);
+    ast::ParallelFunctionVisitor<IdentifierCounter> pfv(
+        &pool, [](Diagnostics *diags) {
+            return std::make_unique<IdentifierCounter>(diags);
+        });
+    std::vector<std::size_t> counts;
+    pfv.run(*prog, &diags,
+            [&](ast::FunctionDeclaration &, IdentifierCounter &counter) {
+                counts.push_back(counter.count);
+            });
+    EXPECT_EQ(counts, expected);
+    EXPECT_EQ(diags.consume_error(),
+              std::ranges::any_of(expected, [](auto n) { return n != 0; }));
+}
+
+TEST(ASTQuery, Basic)
+{
+    Diagnostics diags;
+    semantic::Context ctx;
+    auto prog = analyze("test/query.hlvm", &ctx, &diags);
+    ASSERT_TRUE(prog);
+
+    ast::QueryEngine engine(*prog);
+
+    auto index_exprs = engine.query_as<ast::IndexExpression>(
+        {.kind = ast::NodeKind::index_expression});
+    EXPECT_EQ(index_exprs.size(), 4); // The elements and their rows
+
+    auto *a = index_exprs.back()->base()->symbol();
+    ASSERT_TRUE(a);
+    EXPECT_EQ(engine
+                  .query({.kind = ast::NodeKind::identifier_expression,
+                          .symbol = a})
+                  .size(),
+              2);
+    EXPECT_EQ(
+        engine.query({.kind = ast::NodeKind::binary_expression, .op = "="})
+            .size(),
+        2);
+    EXPECT_TRUE(
+        engine.query({.kind = ast::NodeKind::binary_expression, .op = "+"})
+            .empty());
+}
+
 int main(int argc, char **argv)
 {
     spdlog::set_level(spdlog::level::debug);
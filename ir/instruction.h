@@ -20,6 +20,11 @@ enum class Operator : unsigned char {
     div,
     mod,
 
+    // Set to 1 if the relation holds, else to 0
+    seq,
+    slt,
+    sle,
+
     call,
 
     ret,
@@ -53,6 +58,13 @@ inline std::string_view to_string(Operator op)
     case Operator::mod:
         return "mod";
 
+    case Operator::seq:
+        return "seq";
+    case Operator::slt:
+        return "slt";
+    case Operator::sle:
+        return "sle";
+
     case Operator::call:
         return "call";
     case Operator::ret:
@@ -76,6 +88,16 @@ inline std::string_view to_string(Operator op)
     return "unknown";
 }
 
+/// @brief An instruction and its operands, by operator:
+///
+/// - add, sub, mul, div, mod, seq, slt, sle: dst, lhs, rhs
+/// - load: dst, global slot; store: global slot, src
+/// - call: dst, function label, arguments...
+/// - ret: value
+/// - beq, bne, blt, bge: lhs, rhs, label; j: label
+/// - label: label
+///
+/// Registers are numbered per function, parameters first.
 struct Instruction {
     Operator op;
     std::vector<Operand *> operands;
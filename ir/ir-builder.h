@@ -1,9 +1,16 @@
 #pragma once
+#include <algorithm>
 #include <ast/ast.h>
+#include <ast/parallel-function-visitor.h>
 #include <cassert>
 #include <diagnostics.h>
+#include <format>
 #include <ir/instruction.h>
 #include <semantic/context.h>
+#include <semantic/scope.h>
+#include <semantic/type.h>
+#include <stdexcept>
+#include <string_view>
 
 namespace semantic {
 
@@ -13,26 +20,79 @@ class Context;
 
 namespace ir {
 
+/// @brief Lowers an analyzed program to integer IR.
+///
+/// The instructions start with the entry code, which initializes the globals
+/// and returns what 'main' returns; each function follows its label. Values
+/// other than ints, such as floats, strings and arrays, builtin calls, and
+/// the absent values the other engines give uninitialized variables, bare
+/// returns and functions running off their end have no lowering: visiting
+/// them throws std::runtime_error.
 class IRBuilder : public ast::RecursiveNodeVisitor {
   public:
     IRBuilder() = default;
 
+    void visit(ast::Program &p) override
+    {
+        // Labels first, so that calls may precede their callees
+        auto fds = ast::function_declarations(p);
+        for (auto *fd : fds) {
+            symbol_label_[fd->symbol()] = label();
+        }
+
+        for (auto const &ds : p.declaration_statements()) {
+            if (dynamic_cast<ast::VariableDeclaration *>(
+                    ds->declaration().get()) != nullptr) {
+                ds->accept(*this);
+            }
+        }
+        auto *main = p.global_scope()->lookup_symbol("main");
+        if (main == nullptr || !symbol_label_.contains(main)) {
+            throw std::runtime_error{"Cannot find function 'main'"};
+        }
+        auto *result = reg();
+        emit({.op = Operator::call,
+              .operands = {result, symbol_label_.at(main)}});
+        emit({.op = Operator::ret, .operands = {result}});
+
+        for (auto *fd : fds) {
+            fd->accept(*this);
+        }
+    }
+
     void visit(ast::VariableDeclaration &vd) override
     {
         assert(vd.symbol());
-        auto *id = symbol_reg_[vd.symbol()] = reg();
-        if (vd.init()) {
-            auto *val = emit_expr(vd.init());
-            emit({.op = Operator::add, .operands{id, imm(0), val}});
+        require_int(vd.resolved_type(), vd,
+                    std::format("variable '{}'", vd.name()));
+        if (!vd.init()) {
+            throw std::runtime_error{
+                std::format("{}: Doesn't support uninitialized variable '{}'",
+                            vd.source_range(), vd.name())};
         }
+        assign_to(vd.symbol(), emit_expr(vd.init()));
     }
 
     void visit(ast::FunctionDeclaration &fd) override
     {
-        auto *func_label = symbol_label_[fd.symbol()] = label();
-        emit({.op = Operator::label, .operands = {func_label}});
+        auto *ft = static_cast<semantic::FunctionType *>(fd.symbol()->type_ptr);
+        require_int(ft->return_type, fd,
+                    std::format("return type of '{}'", fd.name()));
+        for (auto const &param : fd.parameters()) {
+            require_int(param.symbol->type_ptr, fd,
+                        std::format("parameter '{}'", param.name));
+        }
+
+        if (!always_returns(*fd.body())) {
+            throw std::runtime_error{
+                std::format("{}: Doesn't support '{}' running off its end",
+                            fd.source_range(), fd.name())};
+        }
+
+        next_reg_id_ = 0;
+        emit({.op = Operator::label,
+              .operands = {symbol_label_.at(fd.symbol())}});
         for (auto const &param : fd.parameters()) {
-            // FIXME: this should be linked to arguments
             symbol_reg_[param.symbol] = reg();
         }
         for (auto const &stmt : fd.body()->statements())
@@ -41,6 +101,10 @@ class IRBuilder : public ast::RecursiveNodeVisitor {
 
     void visit(ast::ReturnStatement &rs) override
     {
+        if (!rs.returned_value()) {
+            throw std::runtime_error{std::format(
+                "{}: Doesn't support returning no value", rs.source_range())};
+        }
         emit({.op = Operator::ret,
               .operands = {emit_expr(rs.returned_value())}});
     }
@@ -77,7 +141,7 @@ class IRBuilder : public ast::RecursiveNodeVisitor {
         // Condition
         emit({.op = Operator::label, .operands = {l_begin}});
         auto *cond = emit_expr(ws.condition());
-        emit({.op = Operator::beq, .operands = {l_end, cond, imm(0)}});
+        emit({.op = Operator::beq, .operands = {cond, imm(0), l_end}});
 
         ws.body()->accept(*this);
 
@@ -92,51 +156,102 @@ class IRBuilder : public ast::RecursiveNodeVisitor {
     {
         auto *expr = emit_expr(e.expr());
         auto *dst = reg();
-        if (e.op() == "-") {
+        switch (e.opcode()) {
+        case semantic::OpCode::int_neg:
             emit({.op = Operator::sub, .operands = {dst, imm(0), expr}});
-        }
-        else if (e.op() == "+") {
+            break;
+        case semantic::OpCode::identity:
             emit({.op = Operator::add, .operands = {dst, imm(0), expr}});
+            break;
+        case semantic::OpCode::float_neg:
+            throw std::runtime_error{
+                std::format("{}: Doesn't support opcode {}", e.source_range(),
+                            to_string(e.opcode()))};
+        default:
+            throw std::logic_error{"Invalid unary opcode"};
         }
         last_register_ = dst;
     }
 
     void visit(ast::BinaryExpression &e) override
     {
-        auto *lhs = emit_expr(e.lhs());
+        using enum semantic::OpCode;
+
+        if (e.opcode() == assign) {
+            auto *ie = dynamic_cast<ast::IdentifierExpression *>(e.lhs().get());
+            if (ie == nullptr) {
+                throw std::runtime_error{
+                    std::format("{}: Doesn't support assigning elements",
+                                e.source_range())};
+            }
+            auto *val = emit_expr(e.rhs());
+            assign_to(ie->symbol(), val);
+            last_register_ = val;
+            return;
+        }
+
+        // Right to left, like the tree walker
         auto *rhs = emit_expr(e.rhs());
+        auto *lhs = emit_expr(e.lhs());
         auto *dst = reg();
-        if (e.op().is(TokenKind::plus)) {
+        switch (e.opcode()) {
+        case int_add:
             emit({.op = Operator::add, .operands = {dst, lhs, rhs}});
-        }
-        else if (e.op().is(TokenKind::minus)) {
+            break;
+        case int_sub:
             emit({.op = Operator::sub, .operands = {dst, lhs, rhs}});
-        }
-        else if (e.op().is(TokenKind::star)) {
+            break;
+        case int_mul:
             emit({.op = Operator::mul, .operands = {dst, lhs, rhs}});
-        }
-        else if (e.op().is(TokenKind::slash)) {
+            break;
+        case int_div:
             emit({.op = Operator::div, .operands = {dst, lhs, rhs}});
-        }
-        else if (e.op().is(TokenKind::percent)) {
+            break;
+        case int_mod:
             emit({.op = Operator::mod, .operands = {dst, lhs, rhs}});
-        }
-        else if (e.op().is(TokenKind::equalequal)) {
-            auto *tmp = reg();
-            emit({.op = Operator::sub, .operands = {tmp, lhs, rhs}});
-            emit({.op = Operator::sub, .operands = {tmp, imm(1), tmp}});
+            break;
+        case int_eq:
+            emit({.op = Operator::seq, .operands = {dst, lhs, rhs}});
+            break;
+        case int_lt:
+            emit({.op = Operator::slt, .operands = {dst, lhs, rhs}});
+            break;
+        case int_le:
+            emit({.op = Operator::sle, .operands = {dst, lhs, rhs}});
+            break;
+        case int_gt:
+            emit({.op = Operator::slt, .operands = {dst, rhs, lhs}});
+            break;
+        case int_ge:
+            emit({.op = Operator::sle, .operands = {dst, rhs, lhs}});
+            break;
+        default:
+            throw std::runtime_error{
+                std::format("{}: Doesn't support opcode {}", e.source_range(),
+                            to_string(e.opcode()))};
         }
         last_register_ = dst;
     }
 
     void visit(ast::IdentifierExpression &e) override
     {
+        if (e.symbol()->storage == semantic::StorageKind::global) {
+            auto *dst = reg();
+            emit({.op = Operator::load,
+                  .operands = {dst, imm(e.symbol()->slot)}});
+            last_register_ = dst;
+            return;
+        }
         if (!symbol_reg_.contains(e.symbol())) {
             throw std::runtime_error{
                 std::format("{}: symbol_reg_ doesn't contain e.symbol(): {}",
                             e.source_range(), e.name())};
         }
-        last_register_ = symbol_reg_.at(e.symbol());
+        // A copy, as the variable may be assigned before the copy is used
+        auto *dst = reg();
+        emit({.op = Operator::add,
+              .operands = {dst, imm(0), symbol_reg_.at(e.symbol())}});
+        last_register_ = dst;
     }
 
     void visit(ast::IntegerLiteralExpr &e) override
@@ -148,35 +263,43 @@ class IRBuilder : public ast::RecursiveNodeVisitor {
 
     void visit(ast::FloatLiteralExpr &e) override
     {
-        auto *dst = reg();
-        emit({.op = Operator::add,
-              .operands = {dst, imm(0), imm(std::stoll(e.value()))}});
-        last_register_ = dst;
+        throw std::runtime_error{std::format(
+            "{}: Doesn't support float literal", e.source_range())};
     }
 
     void visit(ast::StringLiteralExpr &e) override
     {
-        // ?
-        (void)e;
-        throw std::runtime_error{"Doesn't support string literal"};
+        throw std::runtime_error{std::format(
+            "{}: Doesn't support string literal", e.source_range())};
     }
 
     void visit(ast::IndexExpression &e) override
     {
-        // +e.base()->type()->size;
-        (void)e;
-        throw std::runtime_error{"Doesn't support index expression"};
+        throw std::runtime_error{std::format(
+            "{}: Doesn't support index expression", e.source_range())};
     }
 
     void visit(ast::CallExpression &e) override
     {
+        if (e.builtin() != semantic::Builtin::none) {
+            throw std::runtime_error{std::format(
+                "{}: Doesn't support builtin calls", e.source_range())};
+        }
+        auto *dst = reg();
         auto *l = symbol_label_.at(e.callee()->symbol());
         std::vector<Operand *> operands;
+        operands.push_back(dst);
         operands.push_back(l);
         for (auto const &arg : e.arguments()) {
             operands.push_back(emit_expr(arg));
         }
         emit({.op = Operator::call, .operands = std::move(operands)});
+        last_register_ = dst;
+    }
+
+    [[nodiscard]] std::vector<Instruction> const &instructions() const
+    {
+        return instructions_;
     }
 
     void dump()
@@ -199,6 +322,42 @@ class IRBuilder : public ast::RecursiveNodeVisitor {
     }
 
   private:
+    /// @brief Throws unless `type` is int, the only type integer IR has.
+    static void require_int(semantic::Type const *type, ast::Node const &node,
+                            std::string_view what)
+    {
+        using semantic::BuiltinType;
+        if (type == nullptr ||
+            type->typekind != semantic::TypeKind::builtin_type ||
+            static_cast<BuiltinType const *>(type)->builintypekind !=
+                BuiltinType::Kind::integer_type) {
+            throw std::runtime_error{
+                std::format("{}: Doesn't support non-integer {}",
+                            node.source_range(), what)};
+        }
+    }
+
+    /// @brief Whether running `stmt` always ends in a return statement, as
+    /// far as its structure shows.
+    static bool always_returns(ast::Statement const &stmt)
+    {
+        if (dynamic_cast<ast::ReturnStatement const *>(&stmt) != nullptr) {
+            return true;
+        }
+        if (auto const *cs = dynamic_cast<ast::CompoundStatement const *>(
+                &stmt)) {
+            return std::ranges::any_of(cs->statements(), [](auto const &s) {
+                return always_returns(*s);
+            });
+        }
+        if (auto const *is = dynamic_cast<ast::IfStatement const *>(&stmt)) {
+            return is->true_branch() && is->false_branch() &&
+                   always_returns(*is->true_branch()) &&
+                   always_returns(*is->false_branch());
+        }
+        return false;
+    }
+
     void emit(Instruction const &ins)
     {
         instructions_.push_back(ins);
@@ -210,6 +369,21 @@ class IRBuilder : public ast::RecursiveNodeVisitor {
         return last_register_;
     }
 
+    void assign_to(semantic::Symbol *symbol, Operand *val)
+    {
+        if (symbol->storage == semantic::StorageKind::global) {
+            emit({.op = Operator::store,
+                  .operands = {imm(symbol->slot), val}});
+            return;
+        }
+        // Locals of sibling blocks may share a slot, but not a register
+        auto [it, inserted] = symbol_reg_.try_emplace(symbol);
+        if (inserted) {
+            it->second = reg();
+        }
+        emit({.op = Operator::add, .operands = {it->second, imm(0), val}});
+    }
+
     Register *reg()
     {
         registers_.push_back(std::make_unique<Register>(next_reg_id_++));
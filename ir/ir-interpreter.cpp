@@ -0,0 +1,229 @@
+#include <ir/ir-interpreter.h>
+
+#include <algorithm>
+#include <format>
+#include <semantic/operators.h>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+std::int64_t operand_value(ir::Operand const *operand)
+{
+    switch (operand->kind) {
+    case ir::Operand::Kind::op_register:
+        return static_cast<std::int64_t>(
+            static_cast<ir::Register const *>(operand)->id);
+    case ir::Operand::Kind::op_immediate:
+        return static_cast<ir::Immediate const *>(operand)->value;
+    case ir::Operand::Kind::op_label:
+        return static_cast<std::int64_t>(
+            static_cast<ir::Label const *>(operand)->id);
+    }
+    throw std::logic_error{"Invalid operand kind"};
+}
+
+} // namespace
+
+ir::IRInterpreter::IRInterpreter(Diagnostics *diags) : diags_(diags) {}
+
+void ir::IRInterpreter::decode(std::vector<Instruction> const &code)
+{
+    code_.clear();
+    args_.clear();
+    window_ = 1;
+    std::size_t global_count{};
+
+    // Labels mark the instruction after them, and aren't kept
+    std::unordered_map<std::int64_t, std::uint32_t> label_index;
+    for (auto const &ins : code) {
+        if (ins.op == Operator::label) {
+            label_index[operand_value(ins.operands.at(0))] = code_.size();
+        }
+        else {
+            code_.push_back({.op = ins.op});
+        }
+    }
+
+    auto arg = [&](Operand const *operand) {
+        auto is_register = operand->kind == Operand::Kind::op_register;
+        auto value = operand_value(operand);
+        if (is_register) {
+            window_ = std::max(window_, static_cast<std::size_t>(value) + 1);
+        }
+        return Arg{.is_register = is_register, .value = value};
+    };
+    auto target = [&](Operand const *operand) {
+        return label_index.at(operand_value(operand));
+    };
+    auto dst = [&](Operand const *operand) {
+        return static_cast<std::uint32_t>(arg(operand).value);
+    };
+
+    auto decoded = code_.begin();
+    for (auto const &ins : code) {
+        if (ins.op == Operator::label) {
+            continue;
+        }
+        auto const &ops = ins.operands;
+        auto &d = *decoded;
+        switch (ins.op) {
+        case Operator::add:
+        case Operator::sub:
+        case Operator::mul:
+        case Operator::div:
+        case Operator::mod:
+        case Operator::seq:
+        case Operator::slt:
+        case Operator::sle:
+            d.dst = dst(ops.at(0));
+            d.lhs = arg(ops.at(1));
+            d.rhs = arg(ops.at(2));
+            break;
+        case Operator::load:
+            d.dst = dst(ops.at(0));
+            d.lhs = arg(ops.at(1));
+            global_count =
+                std::max<std::size_t>(global_count, d.lhs.value + 1);
+            break;
+        case Operator::store:
+            d.dst = operand_value(ops.at(0));
+            d.lhs = arg(ops.at(1));
+            global_count = std::max<std::size_t>(global_count, d.dst + 1);
+            break;
+        case Operator::call:
+            d.dst = dst(ops.at(0));
+            d.target = target(ops.at(1));
+            d.args = args_.size();
+            d.arg_count = ops.size() - 2;
+            for (std::size_t i = 2; i < ops.size(); ++i) {
+                args_.push_back(arg(ops[i]));
+            }
+            break;
+        case Operator::ret:
+            d.lhs = arg(ops.at(0));
+            break;
+        case Operator::beq:
+        case Operator::bne:
+        case Operator::blt:
+        case Operator::bge:
+            d.lhs = arg(ops.at(0));
+            d.rhs = arg(ops.at(1));
+            d.target = target(ops.at(2));
+            break;
+        case Operator::j:
+            d.target = target(ops.at(0));
+            break;
+        case Operator::label:
+        case Operator::unknown:
+            throw std::logic_error{"Unknown IR operator"};
+        }
+        ++decoded;
+    }
+    globals_.assign(global_count, 0);
+}
+
+std::optional<std::int64_t>
+ir::IRInterpreter::run(std::vector<Instruction> const &code)
+{
+    decode(code);
+    calls_.clear();
+    registers_.assign(window_, 0);
+
+    std::size_t pc{};
+    std::size_t base{};
+    auto value = [&](Arg const &a) {
+        return a.is_register ? registers_[base + a.value] : a.value;
+    };
+
+    while (true) {
+        auto const &ins = code_[pc];
+        auto set = [&](std::int64_t v) { registers_[base + ins.dst] = v; };
+        switch (ins.op) {
+        case Operator::add:
+            set(semantic::wrapping_add(value(ins.lhs), value(ins.rhs)));
+            break;
+        case Operator::sub:
+            set(semantic::wrapping_sub(value(ins.lhs), value(ins.rhs)));
+            break;
+        case Operator::mul:
+            set(semantic::wrapping_mul(value(ins.lhs), value(ins.rhs)));
+            break;
+        case Operator::div:
+        case Operator::mod: {
+            auto rhs = value(ins.rhs);
+            if (rhs == 0) {
+                diags_->error("Division by zero at IR instruction {}", pc);
+                return std::nullopt;
+            }
+            auto lhs = value(ins.lhs);
+            set(ins.op == Operator::div ? semantic::wrapping_div(lhs, rhs)
+                                        : semantic::wrapping_mod(lhs, rhs));
+            break;
+        }
+        case Operator::seq:
+            set(value(ins.lhs) == value(ins.rhs) ? 1 : 0);
+            break;
+        case Operator::slt:
+            set(value(ins.lhs) < value(ins.rhs) ? 1 : 0);
+            break;
+        case Operator::sle:
+            set(value(ins.lhs) <= value(ins.rhs) ? 1 : 0);
+            break;
+        case Operator::load:
+            set(globals_[ins.lhs.value]);
+            break;
+        case Operator::store:
+            globals_[ins.dst] = value(ins.lhs);
+            break;
+        case Operator::call: {
+            auto callee_base = base + window_;
+            if (registers_.size() < callee_base + window_) {
+                registers_.resize(callee_base + window_);
+            }
+            for (std::uint32_t i = 0; i < ins.arg_count; ++i) {
+                registers_[callee_base + i] = value(args_[ins.args + i]);
+            }
+            std::fill(registers_.begin() + callee_base + ins.arg_count,
+                      registers_.begin() + callee_base + window_, 0);
+            calls_.push_back(
+                {.return_pc = pc + 1, .base = base, .dst = ins.dst});
+            base = callee_base;
+            pc = ins.target;
+            continue;
+        }
+        case Operator::ret: {
+            auto result = value(ins.lhs);
+            if (calls_.empty()) {
+                return result;
+            }
+            auto caller = calls_.back();
+            calls_.pop_back();
+            base = caller.base;
+            registers_[base + caller.dst] = result;
+            pc = caller.return_pc;
+            continue;
+        }
+        case Operator::beq:
+            pc = value(ins.lhs) == value(ins.rhs) ? ins.target : pc + 1;
+            continue;
+        case Operator::bne:
+            pc = value(ins.lhs) != value(ins.rhs) ? ins.target : pc + 1;
+            continue;
+        case Operator::blt:
+            pc = value(ins.lhs) < value(ins.rhs) ? ins.target : pc + 1;
+            continue;
+        case Operator::bge:
+            pc = value(ins.lhs) >= value(ins.rhs) ? ins.target : pc + 1;
+            continue;
+        case Operator::j:
+            pc = ins.target;
+            continue;
+        case Operator::label:
+        case Operator::unknown:
+            throw std::logic_error{
+                std::format("Unexpected {} after decoding", to_string(ins.op))};
+        }
+        ++pc;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <diagnostics.h>
+#include <ir/instruction.h>
+#include <optional>
+#include <vector>
+
+namespace ir {
+
+/// @brief Executes the instructions made by the IRBuilder.
+///
+/// The instructions are decoded once: labels are resolved to instruction
+/// indices and operands to register indices or immediates. Registers live in
+/// one flat array, a window of it per call.
+class IRInterpreter {
+  public:
+    explicit IRInterpreter(Diagnostics *diags);
+
+    /// @brief Runs from the first instruction until it returns, and yields
+    /// the returned value, or nullopt after reporting a run-time error.
+    std::optional<std::int64_t> run(std::vector<Instruction> const &code);
+
+  private:
+    struct Arg {
+        bool is_register;
+        std::int64_t value; // Register index, or the immediate
+    };
+
+    struct Decoded {
+        Operator op;
+        std::uint32_t dst{};    // Register, or global slot for a store
+        std::uint32_t target{}; // Instruction index for branches and calls
+        Arg lhs{};
+        Arg rhs{};
+        std::uint32_t args{}; // Of a call: first index into args_
+        std::uint32_t arg_count{};
+    };
+
+    struct CallFrame {
+        std::size_t return_pc;
+        std::size_t base;
+        std::uint32_t dst; // In the caller's window
+    };
+
+    void decode(std::vector<Instruction> const &code);
+
+    Diagnostics *diags_;
+    std::vector<Decoded> code_;
+    std::vector<Arg> args_;
+    std::size_t window_{}; // Registers per call
+    std::vector<std::int64_t> registers_;
+    std::vector<std::int64_t> globals_;
+    std::vector<CallFrame> calls_;
+};
+
+} // namespace ir
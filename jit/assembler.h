@@ -0,0 +1,282 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace jit {
+
+/// @brief Encodes the few x86-64 instructions the JIT emits. Operands are
+/// 64-bit registers, immediates, and memory at a base register plus a
+/// displacement; jumps and calls take 32-bit relative targets, patched once
+/// the target is known.
+class Assembler {
+  public:
+    enum Reg : std::uint8_t {
+        rax,
+        rcx,
+        rdx,
+        rbx,
+        rsp,
+        rbp,
+        rsi,
+        rdi,
+    };
+
+    /// @brief [base + disp]. The base must not be rsp, which would need a
+    /// SIB byte.
+    struct Mem {
+        Reg base;
+        std::int32_t disp;
+    };
+
+    /// @brief Condition codes, as in the low nibble of Jcc and SETcc.
+    enum Cond : std::uint8_t {
+        below = 0x2,
+        equal = 0x4,
+        not_equal = 0x5,
+        less = 0xc,
+        greater_equal = 0xd,
+        less_equal = 0xe,
+        greater = 0xf,
+    };
+
+    [[nodiscard]] std::vector<std::uint8_t> const &code() const
+    {
+        return code_;
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        return code_.size();
+    }
+
+    void push(Reg r)
+    {
+        byte(0x50 + r);
+    }
+
+    void leave()
+    {
+        byte(0xc9);
+    }
+
+    void ret()
+    {
+        byte(0xc3);
+    }
+
+    void cqo()
+    {
+        rex_w();
+        byte(0x99);
+    }
+
+    void mov(Reg dst, Reg src)
+    {
+        rex_w();
+        byte(0x89);
+        byte(0xc0 | src << 3 | dst);
+    }
+
+    void mov(Reg dst, Mem src)
+    {
+        op(0x8b, dst, src);
+    }
+
+    void mov(Mem dst, Reg src)
+    {
+        op(0x89, src, dst);
+    }
+
+    void mov(Reg dst, std::int64_t imm)
+    {
+        if (imm == static_cast<std::int32_t>(imm)) {
+            rex_w();
+            byte(0xc7);
+            byte(0xc0 | dst);
+            imm32(static_cast<std::int32_t>(imm));
+        }
+        else {
+            rex_w();
+            byte(0xb8 + dst);
+            bytes(&imm, sizeof(imm));
+        }
+    }
+
+    /// @brief Stores a sign-extended 32-bit immediate.
+    void mov(Mem dst, std::int32_t imm)
+    {
+        op(0xc7, 0, dst);
+        imm32(imm);
+    }
+
+    void lea(Reg dst, Mem src)
+    {
+        op(0x8d, dst, src);
+    }
+
+    void add(Reg dst, Mem src)
+    {
+        op(0x03, dst, src);
+    }
+
+    void sub(Reg dst, Mem src)
+    {
+        op(0x2b, dst, src);
+    }
+
+    void sub(Reg dst, std::int32_t imm)
+    {
+        rex_w();
+        byte(0x81);
+        byte(0xc0 | 5 << 3 | dst);
+        imm32(imm);
+    }
+
+    void imul(Reg dst, Mem src)
+    {
+        rex_w();
+        byte(0x0f);
+        modrm(0xaf, dst, src);
+    }
+
+    /// @brief Signed division of rdx:rax by `divisor`.
+    void idiv(Reg divisor)
+    {
+        rex_w();
+        byte(0xf7);
+        byte(0xc0 | 7 << 3 | divisor);
+    }
+
+    void neg(Reg r)
+    {
+        rex_w();
+        byte(0xf7);
+        byte(0xc0 | 3 << 3 | r);
+    }
+
+    void neg(Mem m)
+    {
+        op(0xf7, 3, m);
+    }
+
+    void cmp(Reg lhs, Mem rhs)
+    {
+        op(0x3b, lhs, rhs);
+    }
+
+    void cmp(Reg lhs, std::int8_t imm)
+    {
+        rex_w();
+        byte(0x83);
+        byte(0xc0 | 7 << 3 | lhs);
+        byte(static_cast<std::uint8_t>(imm));
+    }
+
+    void cmp(Mem lhs, std::int8_t imm)
+    {
+        op(0x83, 7, lhs);
+        byte(static_cast<std::uint8_t>(imm));
+    }
+
+    void test(Reg lhs, Reg rhs)
+    {
+        rex_w();
+        byte(0x85);
+        byte(0xc0 | rhs << 3 | lhs);
+    }
+
+    /// @brief Sets rax to 1 if `cond` holds, else to 0.
+    void set(Cond cond)
+    {
+        byte(0x0f);
+        byte(0x90 | cond);
+        byte(0xc0); // al
+        byte(0x0f);
+        byte(0xb6);
+        byte(0xc0); // movzx eax, al
+    }
+
+    /// @brief Returns the position of the target to patch.
+    std::size_t jmp()
+    {
+        byte(0xe9);
+        return rel32();
+    }
+
+    /// @brief Returns the position of the target to patch.
+    std::size_t jcc(Cond cond)
+    {
+        byte(0x0f);
+        byte(0x80 | cond);
+        return rel32();
+    }
+
+    /// @brief Returns the position of the target to patch.
+    std::size_t call()
+    {
+        byte(0xe8);
+        return rel32();
+    }
+
+    /// @brief Makes the jump or call whose target is at `at` go to `target`.
+    void patch(std::size_t at, std::size_t target)
+    {
+        auto rel = static_cast<std::int32_t>(static_cast<std::int64_t>(target) -
+                                             static_cast<std::int64_t>(at + 4));
+        std::memcpy(code_.data() + at, &rel, sizeof(rel));
+    }
+
+  private:
+    void byte(unsigned b)
+    {
+        code_.push_back(static_cast<std::uint8_t>(b));
+    }
+
+    void bytes(void const *p, std::size_t n)
+    {
+        auto const *b = static_cast<std::uint8_t const *>(p);
+        code_.insert(code_.end(), b, b + n);
+    }
+
+    void imm32(std::int32_t imm)
+    {
+        bytes(&imm, sizeof(imm));
+    }
+
+    std::size_t rel32()
+    {
+        imm32(0);
+        return code_.size() - 4;
+    }
+
+    void rex_w()
+    {
+        byte(0x48);
+    }
+
+    /// @brief REX.W, `opcode`, then the ModRM byte of `reg` and `m`.
+    void op(unsigned opcode, unsigned reg, Mem m)
+    {
+        rex_w();
+        modrm(opcode, reg, m);
+    }
+
+    void modrm(unsigned opcode, unsigned reg, Mem m)
+    {
+        byte(opcode);
+        if (m.disp == static_cast<std::int8_t>(m.disp)) {
+            byte(0x40 | reg << 3 | m.base);
+            byte(static_cast<std::uint8_t>(m.disp));
+        }
+        else {
+            byte(0x80 | reg << 3 | m.base);
+            imm32(m.disp);
+        }
+    }
+
+    std::vector<std::uint8_t> code_;
+};
+
+} // namespace jit
@@ -0,0 +1,498 @@
+#include <jit/jit.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <jit/assembler.h>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using jit::Assembler;
+using vm::Op;
+
+/// Whether the instruction can be compiled, provided its callee can.
+bool is_compilable(vm::Module const &module, vm::Instruction const &ins)
+{
+    switch (ins.op) {
+    case Op::push_const: {
+        auto kind = module.constants[ins.operand].kind();
+        return kind == semantic::Value::Kind::integer ||
+               kind == semantic::Value::Kind::none;
+    }
+    case Op::pop:
+    case Op::dup:
+    case Op::load_local:
+    case Op::store_local:
+    case Op::int_add:
+    case Op::int_sub:
+    case Op::int_mul:
+    case Op::int_div:
+    case Op::int_mod:
+    case Op::int_eq:
+    case Op::int_lt:
+    case Op::int_le:
+    case Op::int_gt:
+    case Op::int_ge:
+    case Op::int_neg:
+    case Op::jump:
+    case Op::jump_if_false:
+    case Op::call:
+    case Op::tail_call:
+    case Op::ret:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Net operand stack effect of a compilable instruction.
+int stack_effect(vm::Module const &module, vm::Instruction const &ins)
+{
+    switch (ins.op) {
+    case Op::push_const:
+    case Op::dup:
+    case Op::load_local:
+        return 1;
+    case Op::call:
+    case Op::tail_call:
+        return 1 - static_cast<int>(
+                       module.functions[ins.operand].parameter_count);
+    case Op::int_neg:
+    case Op::jump:
+        return 0;
+    default: // Binary operators, and the others popping one value
+        return -1;
+    }
+}
+
+/// The operand stack depth before each instruction of `f`, -1 where
+/// unreachable. Nullopt if a reachable instruction can't be compiled, or if
+/// the depths of the paths to an instruction disagree.
+std::optional<std::vector<int>> stack_depths(vm::Module const &module,
+                                             vm::Function const &f)
+{
+    std::vector<int> depth(f.code.size(), -1);
+    if (f.code.empty()) {
+        return std::nullopt;
+    }
+    depth[0] = 0;
+    std::vector<std::uint32_t> work{0};
+    while (!work.empty()) {
+        auto pc = work.back();
+        work.pop_back();
+        auto const &ins = f.code[pc];
+        if (!is_compilable(module, ins)) {
+            return std::nullopt;
+        }
+        auto after = depth[pc] + stack_effect(module, ins);
+        if (after < 0 || std::cmp_greater(after, f.max_stack)) {
+            return std::nullopt;
+        }
+        auto flow = [&](std::uint32_t to) {
+            if (to >= f.code.size()) {
+                return false;
+            }
+            if (depth[to] == -1) {
+                depth[to] = after;
+                work.push_back(to);
+            }
+            return depth[to] == after;
+        };
+        bool consistent{true};
+        switch (ins.op) {
+        case Op::ret:
+            break;
+        case Op::jump:
+            consistent = flow(ins.operand);
+            break;
+        case Op::jump_if_false:
+            consistent = flow(pc + 1) && flow(ins.operand);
+            break;
+        default:
+            consistent = flow(pc + 1);
+            break;
+        }
+        if (!consistent) {
+            return std::nullopt;
+        }
+    }
+    return depth;
+}
+
+/// Emits the functions having stack depths. Returns the offset of each in
+/// the code, calls between them being patched.
+std::vector<std::size_t>
+emit_functions(Assembler &a, vm::Module const &module,
+               std::vector<std::optional<std::vector<int>>> const &depths)
+{
+    using enum Assembler::Reg;
+    std::vector<std::size_t> starts(module.functions.size());
+    std::vector<std::pair<std::size_t, std::uint32_t>> calls;
+
+    for (std::uint32_t index = 0; index < module.functions.size(); ++index) {
+        if (!depths[index]) {
+            continue;
+        }
+        auto const &f = module.functions[index];
+        auto const &depth = *depths[index];
+
+        // Slots are the locals, then the operand stack, upwards from rsp.
+        // rbp - 8 holds the saved rbx, which points to the Runtime.
+        auto frame = 8 * static_cast<std::int32_t>(f.frame_size + f.max_stack);
+        frame += (frame + 8) % 16; // Keeps rsp 16-byte aligned
+        auto slot = [&](std::int64_t k) {
+            return Assembler::Mem{rbp, static_cast<std::int32_t>(
+                                           -8 - frame + 8 * k)};
+        };
+        auto stack = [&](std::int64_t k) { return slot(f.frame_size + k); };
+
+        starts[index] = a.size();
+        a.push(rbp);
+        a.mov(rbp, rsp);
+        a.push(rbx);
+        a.mov(rbx, rsi);
+        a.sub(rsp, frame);
+        a.cmp(rsp, Assembler::Mem{rbx, offsetof(jit::Runtime, stack_limit)});
+        auto to_overflow = a.jcc(Assembler::below);
+        for (std::uint32_t i = 0; i < f.parameter_count; ++i) {
+            a.mov(rax, Assembler::Mem{rdi, static_cast<std::int32_t>(8 * i)});
+            a.mov(slot(i), rax);
+        }
+        for (auto i = f.parameter_count; i < f.frame_size; ++i) {
+            a.mov(slot(i), std::int32_t{});
+        }
+
+        std::vector<std::size_t> at(f.code.size());
+        std::vector<std::pair<std::size_t, std::uint32_t>> jumps;
+        std::vector<std::size_t> to_division_by_zero;
+        std::vector<std::size_t> to_epilogue;
+        auto epilogue = [&] {
+            a.mov(rbx, Assembler::Mem{rbp, -8});
+            a.leave();
+            a.ret();
+        };
+
+        for (std::uint32_t pc = 0; pc < f.code.size(); ++pc) {
+            if (depth[pc] == -1) {
+                continue;
+            }
+            at[pc] = a.size();
+            auto const &ins = f.code[pc];
+            auto d = depth[pc];
+            // The left operand of a binary operator is on top, and the
+            // result replaces the right one
+            auto lhs = stack(d - 1);
+            auto rhs = stack(d - 2);
+            auto binary = [&](auto &&op) {
+                a.mov(rax, lhs);
+                op();
+                a.mov(rhs, rax);
+            };
+            auto comparison = [&](Assembler::Cond cond) {
+                binary([&] {
+                    a.cmp(rax, rhs);
+                    a.set(cond);
+                });
+            };
+
+            switch (ins.op) {
+            case Op::push_const: {
+                auto const &value = module.constants[ins.operand];
+                auto i = value.kind() == semantic::Value::Kind::integer
+                             ? value.as_int()
+                             : 0;
+                if (i == static_cast<std::int32_t>(i)) {
+                    a.mov(stack(d), static_cast<std::int32_t>(i));
+                }
+                else {
+                    a.mov(rax, i);
+                    a.mov(stack(d), rax);
+                }
+                break;
+            }
+            case Op::pop:
+                break;
+            case Op::dup:
+                a.mov(rax, stack(d - 1));
+                a.mov(stack(d), rax);
+                break;
+            case Op::load_local:
+                a.mov(rax, slot(ins.operand));
+                a.mov(stack(d), rax);
+                break;
+            case Op::store_local:
+                a.mov(rax, stack(d - 1));
+                a.mov(slot(ins.operand), rax);
+                break;
+            case Op::int_add:
+                binary([&] { a.add(rax, rhs); });
+                break;
+            case Op::int_sub:
+                binary([&] { a.sub(rax, rhs); });
+                break;
+            case Op::int_mul:
+                binary([&] { a.imul(rax, rhs); });
+                break;
+            case Op::int_div:
+            case Op::int_mod: {
+                a.mov(rcx, rhs);
+                a.test(rcx, rcx);
+                to_division_by_zero.push_back(a.jcc(Assembler::equal));
+                a.mov(rax, lhs);
+                // idiv traps on INT64_MIN / -1, which wraps instead
+                a.cmp(rcx, std::int8_t{-1});
+                auto to_divide = a.jcc(Assembler::not_equal);
+                if (ins.op == Op::int_div) {
+                    a.neg(rax);
+                }
+                else {
+                    a.mov(rax, std::int64_t{});
+                }
+                auto to_done = a.jmp();
+                a.patch(to_divide, a.size());
+                a.cqo();
+                a.idiv(rcx);
+                if (ins.op == Op::int_mod) {
+                    a.mov(rax, rdx);
+                }
+                a.patch(to_done, a.size());
+                a.mov(rhs, rax);
+                break;
+            }
+            case Op::int_eq:
+                comparison(Assembler::equal);
+                break;
+            case Op::int_lt:
+                comparison(Assembler::less);
+                break;
+            case Op::int_le:
+                comparison(Assembler::less_equal);
+                break;
+            case Op::int_gt:
+                comparison(Assembler::greater);
+                break;
+            case Op::int_ge:
+                comparison(Assembler::greater_equal);
+                break;
+            case Op::int_neg:
+                a.neg(lhs);
+                break;
+            case Op::jump:
+                jumps.emplace_back(a.jmp(), ins.operand);
+                break;
+            case Op::jump_if_false:
+                a.mov(rax, lhs);
+                a.test(rax, rax);
+                jumps.emplace_back(a.jcc(Assembler::equal), ins.operand);
+                break;
+            case Op::tail_call:
+                if (ins.operand == index) {
+                    // Loops: the arguments become the parameters
+                    auto args = d - static_cast<int>(f.parameter_count);
+                    for (std::uint32_t i = 0; i < f.parameter_count; ++i) {
+                        a.mov(rax, stack(args + i));
+                        a.mov(slot(i), rax);
+                    }
+                    for (auto i = f.parameter_count; i < f.frame_size; ++i) {
+                        a.mov(slot(i), std::int32_t{});
+                    }
+                    a.patch(a.jmp(), at[0]);
+                    break;
+                }
+                if (auto n = module.functions[ins.operand].parameter_count;
+                    n <= jit::Runtime::max_tail_call_args) {
+                    // The arguments move out of the frame, which is left
+                    auto args = d - static_cast<int>(n);
+                    auto const out = static_cast<std::int32_t>(
+                        offsetof(jit::Runtime, tail_call_args));
+                    for (std::uint32_t i = 0; i < n; ++i) {
+                        a.mov(rax, stack(args + i));
+                        a.mov(Assembler::Mem{rbx, out + 8 * static_cast<
+                                                          std::int32_t>(i)},
+                              rax);
+                    }
+                    a.lea(rdi, Assembler::Mem{rbx, out});
+                    a.mov(rsi, rbx);
+                    a.mov(rbx, Assembler::Mem{rbp, -8});
+                    a.leave();
+                    calls.emplace_back(a.jmp(), ins.operand);
+                    break;
+                }
+                [[fallthrough]]; // The return follows the call
+            case Op::call: {
+                auto args =
+                    d - static_cast<int>(
+                            module.functions[ins.operand].parameter_count);
+                a.lea(rdi, stack(args));
+                a.mov(rsi, rbx);
+                calls.emplace_back(a.call(), ins.operand);
+                a.cmp(Assembler::Mem{rbx, offsetof(jit::Runtime, error)},
+                      std::int8_t{});
+                to_epilogue.push_back(a.jcc(Assembler::not_equal));
+                a.mov(stack(args), rax);
+                break;
+            }
+            case Op::ret:
+                a.mov(rax, lhs);
+                epilogue();
+                break;
+            default:
+                throw std::logic_error{"Instruction not compilable"};
+            }
+        }
+
+        auto fail = [&](jit::Runtime::Error error) {
+            a.mov(Assembler::Mem{rbx, offsetof(jit::Runtime, error)},
+                  static_cast<std::int32_t>(error));
+            a.mov(Assembler::Mem{rbx, offsetof(jit::Runtime, function)},
+                  static_cast<std::int32_t>(index));
+        };
+        a.patch(to_overflow, a.size());
+        fail(jit::Runtime::stack_overflow);
+        to_epilogue.push_back(a.jmp());
+        for (auto at_jump : to_division_by_zero) {
+            a.patch(at_jump, a.size());
+        }
+        fail(jit::Runtime::division_by_zero);
+        for (auto at_jump : to_epilogue) {
+            a.patch(at_jump, a.size());
+        }
+        epilogue();
+
+        for (auto [at_jump, target] : jumps) {
+            a.patch(at_jump, at[target]);
+        }
+    }
+
+    for (auto [at_call, callee] : calls) {
+        a.patch(at_call, starts[callee]);
+    }
+    return starts;
+}
+
+} // namespace
+
+jit::Code::Code(Code &&other) noexcept
+    : memory_(std::exchange(other.memory_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      entries_(std::move(other.entries_))
+{
+}
+
+jit::Code &jit::Code::operator=(Code &&other) noexcept
+{
+    std::swap(memory_, other.memory_);
+    std::swap(size_, other.size_);
+    std::swap(entries_, other.entries_);
+    return *this;
+}
+
+jit::Code::~Code()
+{
+#if defined(__linux__)
+    if (memory_ != nullptr) {
+        munmap(memory_, size_);
+    }
+#endif
+}
+
+std::size_t jit::Code::compiled() const
+{
+    return std::ranges::count_if(entries_,
+                                 [](Entry e) { return e != nullptr; });
+}
+
+std::uintptr_t jit::Runtime::thread_stack_limit()
+{
+#if defined(__linux__)
+    // Leaves room for the code calling into native code, and for signal
+    // handlers
+    constexpr std::uintptr_t reserve = 256 << 10;
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        return 0;
+    }
+    void *low{};
+    std::size_t size{};
+    pthread_attr_getstack(&attr, &low, &size);
+    pthread_attr_destroy(&attr);
+    return size > 2 * reserve ? reinterpret_cast<std::uintptr_t>(low) + reserve
+                              : 0;
+#else
+    return 0;
+#endif
+}
+
+jit::Code jit::Compiler::compile(vm::Module const &module)
+{
+    Code result;
+    result.entries_.assign(module.functions.size(), nullptr);
+    if constexpr (!supported) {
+        return result;
+    }
+
+    std::vector<std::optional<std::vector<int>>> depths;
+    for (auto const &f : module.functions) {
+        depths.push_back(stack_depths(module, f));
+    }
+    // Calling a function that isn't compiled excludes the caller
+    for (bool changed{true}; changed;) {
+        changed = false;
+        for (std::size_t i = 0; i < module.functions.size(); ++i) {
+            if (!depths[i]) {
+                continue;
+            }
+            auto const &code = module.functions[i].code;
+            for (std::size_t pc = 0; pc < code.size(); ++pc) {
+                auto is_call = code[pc].op == Op::call ||
+                               code[pc].op == Op::tail_call;
+                if ((*depths[i])[pc] != -1 && is_call &&
+                    !depths[code[pc].operand]) {
+                    depths[i].reset();
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    if (std::ranges::none_of(depths,
+                             [](auto const &d) { return d.has_value(); })) {
+        return result;
+    }
+
+    Assembler a;
+    auto starts = emit_functions(a, module, depths);
+
+#if defined(__linux__)
+    auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto size = (a.size() + page - 1) / page * page;
+    auto *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::system_error{errno, std::generic_category(), "mmap"};
+    }
+    result.memory_ = memory;
+    result.size_ = size;
+    std::memcpy(memory, a.code().data(), a.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        throw std::system_error{errno, std::generic_category(), "mprotect"};
+    }
+    for (std::size_t i = 0; i < module.functions.size(); ++i) {
+        if (depths[i]) {
+            result.entries_[i] = reinterpret_cast<Entry>(
+                static_cast<std::uint8_t *>(memory) + starts[i]);
+        }
+    }
+#endif
+    return result;
+}
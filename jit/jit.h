@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <vm/bytecode.h>
+
+namespace jit {
+
+#if defined(__x86_64__) && defined(__linux__)
+inline constexpr bool supported = true;
+#else
+inline constexpr bool supported = false;
+#endif
+
+/// @brief State shared by native code and the VM calling it. Native code
+/// relies on the field offsets.
+struct Runtime {
+    enum Error : std::int64_t {
+        none,
+        division_by_zero,
+        stack_overflow,
+    };
+
+    /// @brief A stack limit for native code on the calling thread, leaving
+    /// a reserve below it. 0, i.e. no limit, if the stack is unknown.
+    static std::uintptr_t thread_stack_limit();
+
+    static constexpr std::size_t max_tail_call_args = 16;
+
+    std::uintptr_t stack_limit; // Native frames must stay above it
+    Error error;
+    std::int64_t function; // Index of the function failing
+    // Arguments of a tail call, outliving the frame of the caller
+    std::int64_t tail_call_args[max_tail_call_args];
+};
+static_assert(offsetof(Runtime, stack_limit) == 0 &&
+              offsetof(Runtime, error) == 8 &&
+              offsetof(Runtime, function) == 16 &&
+              offsetof(Runtime, tail_call_args) == 24);
+
+/// @brief A compiled function. `args` holds its parameters in order. After
+/// an error it returns at once, leaving the error in `runtime`.
+using Entry = std::int64_t (*)(std::int64_t const *args, Runtime *runtime);
+
+/// @brief Machine code for the functions of a module, in executable memory
+/// it owns.
+class Code {
+  public:
+    Code() = default;
+    Code(Code const &) = delete;
+    Code(Code &&other) noexcept;
+    Code &operator=(Code const &) = delete;
+    Code &operator=(Code &&other) noexcept;
+    ~Code();
+
+    /// @brief The native code of function `index` of the module, or nullptr
+    /// if it wasn't compiled.
+    [[nodiscard]] Entry entry(std::uint32_t index) const
+    {
+        return index < entries_.size() ? entries_[index] : nullptr;
+    }
+
+    /// @brief Number of functions compiled.
+    [[nodiscard]] std::size_t compiled() const;
+
+  private:
+    friend class Compiler;
+
+    void *memory_{};
+    std::size_t size_{};
+    std::vector<Entry> entries_; // Per function of the module
+};
+
+/// @brief Compiles the integer-only functions of a bytecode module to x86-64.
+///
+/// A function is compiled if it only uses integer constants, locals,
+/// integer arithmetic and comparisons, jumps, and calls to functions that
+/// are compiled too; uninitialized values read as 0. Each instruction
+/// becomes a fixed sequence on a native frame holding the locals and the
+/// operand stack, whose depth at each instruction is known statically. Tail
+/// calls leave the frame before jumping to the callee, or loop when the
+/// callee is the caller. On other platforms nothing is compiled.
+class Compiler {
+  public:
+    Code compile(vm::Module const &module);
+};
+
+} // namespace jit
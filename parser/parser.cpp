@@ -653,7 +653,7 @@ ast::ExpressionPtr Parser::parse_primary_expression()
     case integer_literal: {
         auto t = consume();
         auto expr = std::make_unique<ast::IntegerLiteralExpr>();
-        expr->value_ = t.value;
+        expr->set_value(t.value);
         expr->set_source_begin(t.source_range.begin);
         expr->set_source_end(t.source_range.end);
         return expr;
@@ -0,0 +1,94 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace semantic {
+
+/// @brief Bump allocator for objects that live as long as their owner, such
+/// as the scopes and symbols of a Context.
+///
+/// Objects are carved out of large chunks, so making one costs a pointer bump
+/// instead of a heap allocation. They are never freed individually; the arena
+/// runs their destructors, in reverse order of creation, when it dies.
+///
+/// Not thread-safe.
+class Arena {
+  public:
+    explicit Arena(std::size_t chunk_size = 16 * 1024)
+        : chunk_size_(chunk_size)
+    {
+    }
+
+    Arena(Arena const &) = delete;
+    Arena(Arena &&) = delete;
+    Arena &operator=(Arena const &) = delete;
+    Arena &operator=(Arena &&) = delete;
+
+    ~Arena()
+    {
+        for (auto *f = finalizers_; f != nullptr; f = f->next) {
+            f->destroy(f->object);
+        }
+    }
+
+    template <typename T, typename... Args> T *make(Args &&...args)
+    {
+        auto *p = new (allocate(sizeof(T), alignof(T)))
+            T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            finalizers_ = new (allocate(sizeof(Finalizer), alignof(Finalizer)))
+                Finalizer{.destroy = [](void *q) { static_cast<T *>(q)->~T(); },
+                          .object = p,
+                          .next = finalizers_};
+        }
+        return p;
+    }
+
+    void *allocate(std::size_t size, std::size_t alignment)
+    {
+        auto space = static_cast<std::size_t>(end_ - cursor_);
+        void *p = cursor_;
+        if (cursor_ == nullptr ||
+            std::align(alignment, size, p, space) == nullptr) {
+            // Oversized objects get a chunk of their own
+            auto bytes = std::max(chunk_size_, size + alignment);
+            auto &chunk = chunks_.emplace_back(
+                std::make_unique_for_overwrite<std::byte[]>(bytes));
+            cursor_ = chunk.get();
+            end_ = cursor_ + bytes;
+            bytes_reserved_ += bytes;
+            space = bytes;
+            p = cursor_;
+            std::align(alignment, size, p, space);
+        }
+        cursor_ = static_cast<std::byte *>(p) + size;
+        return p;
+    }
+
+    /// @brief Total size of the chunks allocated so far.
+    [[nodiscard]] std::size_t bytes_reserved() const
+    {
+        return bytes_reserved_;
+    }
+
+  private:
+    struct Finalizer {
+        void (*destroy)(void *);
+        void *object;
+        Finalizer *next;
+    };
+
+    std::size_t chunk_size_;
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+    std::byte *cursor_{};
+    std::byte *end_{};
+    std::size_t bytes_reserved_{};
+    Finalizer *finalizers_{}; // Most recently made object first
+};
+
+} // namespace semantic
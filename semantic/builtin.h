@@ -0,0 +1,22 @@
+#pragma once
+#include <string_view>
+
+namespace semantic {
+
+/// @brief A function the language provides. It is called by name, unless a
+/// declaration of the same name is in scope.
+enum class Builtin : unsigned char {
+    none, // A declared function, or not analyzed
+
+    print, // Prints its argument, and evaluates to 0
+};
+
+constexpr Builtin builtin_named(std::string_view name)
+{
+    if (name == "print") {
+        return Builtin::print;
+    }
+    return Builtin::none;
+}
+
+} // namespace semantic
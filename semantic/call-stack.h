@@ -0,0 +1,128 @@
+#pragma once
+#include <algorithm>
+#include <ast/node.h>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <semantic/value.h>
+#include <span>
+#include <vector>
+
+namespace semantic {
+
+/// @brief The frames of the interpreter, contiguous on one value stack.
+///
+/// A frame is the slots of a call, indexed by the slots the analyzer
+/// assigned. Entering and leaving a frame moves the frame and stack
+/// pointers; the storage only grows when the recursion gets deeper than
+/// ever before, so calls don't allocate.
+class CallStack {
+  public:
+    /// @brief Pushes a value above the current frame, e.g. an argument of
+    /// the next call.
+    void push(Value value)
+    {
+        reserve(1);
+        values_[sp_++] = value;
+    }
+
+    /// @brief The `n` values pushed last, oldest first. Invalidated by the
+    /// next push or call.
+    [[nodiscard]] std::span<Value const> top(std::size_t n) const
+    {
+        return {values_.data() + (sp_ - n), n};
+    }
+
+    void pop(std::size_t n)
+    {
+        sp_ -= n;
+    }
+
+    /// @brief Enters a frame of `frame_size` slots whose first slots are the
+    /// `arg_count` values pushed last.
+    void enter(std::size_t frame_size, std::size_t arg_count)
+    {
+        frames_.push_back(fp_);
+        fp_ = sp_ - arg_count;
+        reserve(frame_size - arg_count);
+        auto *base = values_.data() + fp_;
+        std::fill(base + arg_count, base + frame_size, Value{});
+        sp_ = fp_ + frame_size;
+    }
+
+    /// @brief Replaces the current frame by one of `frame_size` slots whose
+    /// first slots are the `arg_count` values pushed last, as a tail call.
+    void replace(std::size_t frame_size, std::size_t arg_count)
+    {
+        std::copy(values_.begin() + (sp_ - arg_count), values_.begin() + sp_,
+                  values_.begin() + fp_);
+        sp_ = fp_ + arg_count;
+        reserve(frame_size - arg_count);
+        std::fill(values_.begin() + sp_, values_.begin() + fp_ + frame_size,
+                  Value{});
+        sp_ = fp_ + frame_size;
+    }
+
+    void leave()
+    {
+        sp_ = fp_;
+        fp_ = frames_.back();
+        frames_.pop_back();
+    }
+
+    /// @brief The storage of `slot` in the current frame. Invalidated by
+    /// deeper calls.
+    Value &operator[](std::uint32_t slot)
+    {
+        return values_[fp_ + slot];
+    }
+
+    /// @brief Drops all frames, e.g. those a failed run left. Keeps the
+    /// storage.
+    void clear()
+    {
+        frames_.clear();
+        fp_ = 0;
+        sp_ = 0;
+    }
+
+    [[nodiscard]] std::size_t depth() const
+    {
+        return frames_.size();
+    }
+
+    void dump(std::ostream &os) const
+    {
+        if (frames_.empty()) {
+            return;
+        }
+        // frames_[0] is the frame pointer from before the outermost frame
+        std::vector<std::size_t> bases(frames_.begin() + 1, frames_.end());
+        bases.push_back(fp_);
+        for (std::size_t i = 0; i < bases.size(); ++i) {
+            auto end = i + 1 < bases.size() ? bases[i + 1] : sp_;
+            make_indent(os, static_cast<int>(i));
+            std::println(os, "Frame:");
+            for (auto slot = bases[i]; slot < end; ++slot) {
+                make_indent(os, static_cast<int>(i) + 1);
+                std::println(os, "#{}: {}", slot - bases[i],
+                             values_[slot].to_string());
+            }
+        }
+    }
+
+  private:
+    void reserve(std::size_t n)
+    {
+        if (sp_ + n > values_.size()) {
+            values_.resize(std::max(values_.size() * 2, sp_ + n));
+        }
+    }
+
+    std::vector<Value> values_;
+    std::size_t fp_{};
+    std::size_t sp_{};
+    std::vector<std::size_t> frames_; // Frame pointers of the callers
+};
+
+} // namespace semantic
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace semantic {
+
+/// @brief How the execution of a statement ended. Anything but `normal`
+/// unwinds the enclosing statements up to whatever handles it.
+enum class Completion : unsigned char {
+    normal,
+    returned,  // Handled by the call
+    tail_call, // Handled by the call, running the callee in its frame
+    failed,    // An error was reported: ends the run
+};
+
+} // namespace semantic
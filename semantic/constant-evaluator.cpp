@@ -0,0 +1,329 @@
+#include <semantic/constant-evaluator.h>
+
+#include <semantic/completion.h>
+#include <semantic/purity.h>
+#include <semantic/symbol.h>
+#include <string>
+
+/// Executes function bodies on integers. Throws Abort on anything it cannot
+/// evaluate, and when the step budget runs out.
+class semantic::ConstantEvaluator::Machine {
+  public:
+    struct Abort {};
+
+    explicit Machine(ConstantEvaluator *owner)
+        : owner_(owner), steps_left_(owner->step_budget_)
+    {
+    }
+
+    std::int64_t call(ast::FunctionDeclaration const &fd,
+                      std::vector<std::int64_t> args)
+    {
+        auto key = std::make_pair(&fd, std::move(args));
+        if (auto it = owner_->memo_.find(key); it != owner_->memo_.end()) {
+            ++owner_->stats_.memo_hits;
+            return it->second;
+        }
+        if (depth_ == max_depth) {
+            throw Abort{};
+        }
+        ++owner_->stats_.evaluated;
+
+        auto caller_base = std::exchange(frame_base_, env_.size());
+        ++depth_;
+        for (std::size_t i = 0; i < fd.parameters().size(); ++i) {
+            env_.emplace_back(fd.parameters()[i].symbol, key.second[i]);
+        }
+
+        std::optional<std::int64_t> result;
+        for (auto const &stmt : fd.body()->statements()) {
+            if (execute(*stmt) == Completion::returned) {
+                result = returned_;
+                break;
+            }
+        }
+        if (!result.has_value()) {
+            throw Abort{}; // Fell off the end without a value
+        }
+
+        --depth_;
+        env_.resize(frame_base_);
+        frame_base_ = caller_base;
+        owner_->memo_.insert({std::move(key), *result});
+        return *result;
+    }
+
+    std::int64_t eval(ast::Expression &e)
+    {
+        step();
+        if (auto *ie = dynamic_cast<ast::IntegerLiteralExpr *>(&e)) {
+            return ie->value();
+        }
+        if (auto *ie = dynamic_cast<ast::IdentifierExpression *>(&e)) {
+            return *slot(ie->symbol());
+        }
+        if (auto *ue = dynamic_cast<ast::UnaryExpression *>(&e)) {
+            auto value = eval(*ue->expr());
+            switch (ue->opcode()) {
+            case OpCode::int_neg:
+                return checked(__builtin_sub_overflow(0, value, &value),
+                               value);
+            case OpCode::identity:
+                return value;
+            default:
+                throw Abort{};
+            }
+        }
+        if (auto *be = dynamic_cast<ast::BinaryExpression *>(&e)) {
+            return eval_binary(*be);
+        }
+        if (auto *ce = dynamic_cast<ast::CallExpression *>(&e)) {
+            auto *fd = ce->target();
+            if (fd == nullptr || !owner_->purity_->is_pure(fd)) {
+                throw Abort{};
+            }
+            std::vector<std::int64_t> args;
+            for (auto const &arg : ce->arguments()) {
+                args.push_back(eval(*arg));
+            }
+            return call(*fd, std::move(args));
+        }
+        throw Abort{};
+    }
+
+  private:
+    // Bounds the native recursion of the evaluator itself
+    static constexpr std::size_t max_depth = 512;
+
+    Completion execute(ast::Statement &s)
+    {
+        step();
+        if (auto *cs = dynamic_cast<ast::CompoundStatement *>(&s)) {
+            auto size = env_.size();
+            auto completion = Completion::normal;
+            for (auto const &stmt : cs->statements()) {
+                completion = execute(*stmt);
+                if (completion == Completion::returned) {
+                    break;
+                }
+            }
+            env_.resize(size);
+            return completion;
+        }
+        if (auto *ds = dynamic_cast<ast::DeclarationStatement *>(&s)) {
+            auto *vd = dynamic_cast<ast::VariableDeclaration *>(
+                ds->declaration().get());
+            if (vd == nullptr || !vd->init()) {
+                throw Abort{};
+            }
+            auto value = eval(*vd->init());
+            env_.emplace_back(vd->symbol(), value);
+            return Completion::normal;
+        }
+        if (auto *es = dynamic_cast<ast::ExpressionStatement *>(&s)) {
+            eval(*es->expr());
+            return Completion::normal;
+        }
+        if (auto *rs = dynamic_cast<ast::ReturnStatement *>(&s)) {
+            if (!rs->returned_value()) {
+                throw Abort{};
+            }
+            returned_ = eval(*rs->returned_value());
+            return Completion::returned;
+        }
+        if (auto *is = dynamic_cast<ast::IfStatement *>(&s)) {
+            if (eval(*is->condition()) != 0) {
+                return execute(*is->true_branch());
+            }
+            return is->false_branch() ? execute(*is->false_branch())
+                                      : Completion::normal;
+        }
+        if (auto *ws = dynamic_cast<ast::WhileStatement *>(&s)) {
+            while (eval(*ws->condition()) != 0) {
+                if (execute(*ws->body()) == Completion::returned) {
+                    return Completion::returned;
+                }
+            }
+            return Completion::normal;
+        }
+        if (dynamic_cast<ast::EmptyStatement *>(&s) != nullptr) {
+            return Completion::normal;
+        }
+        throw Abort{};
+    }
+
+    std::int64_t eval_binary(ast::BinaryExpression &be)
+    {
+        using enum OpCode;
+
+        if (be.opcode() == assign) {
+            auto *lhs =
+                dynamic_cast<ast::IdentifierExpression *>(be.lhs().get());
+            if (lhs == nullptr) {
+                throw Abort{};
+            }
+            auto value = eval(*be.rhs()); // May grow env_
+            return *slot(lhs->symbol()) = value;
+        }
+
+        // Same order as the interpreter, though nothing here has effects
+        auto rhs = eval(*be.rhs());
+        auto lhs = eval(*be.lhs());
+        std::int64_t result{};
+        switch (be.opcode()) {
+        case int_add:
+            return checked(__builtin_add_overflow(lhs, rhs, &result), result);
+        case int_sub:
+            return checked(__builtin_sub_overflow(lhs, rhs, &result), result);
+        case int_mul:
+            return checked(__builtin_mul_overflow(lhs, rhs, &result), result);
+        case int_div:
+        case int_mod:
+            if (rhs == 0 || (lhs == INT64_MIN && rhs == -1)) {
+                throw Abort{};
+            }
+            return be.opcode() == int_div ? lhs / rhs : lhs % rhs;
+        case int_eq:
+            return lhs == rhs ? 1 : 0;
+        case int_lt:
+            return lhs < rhs ? 1 : 0;
+        case int_le:
+            return lhs <= rhs ? 1 : 0;
+        case int_gt:
+            return lhs > rhs ? 1 : 0;
+        case int_ge:
+            return lhs >= rhs ? 1 : 0;
+        default:
+            throw Abort{};
+        }
+    }
+
+    // Takes the result by reference, so that it is read only after the
+    // overflow builtin has written it.
+    static std::int64_t checked(bool overflowed, std::int64_t const &value)
+    {
+        if (overflowed) {
+            throw Abort{};
+        }
+        return value;
+    }
+
+    // Only the variables of the current call are visible
+    std::int64_t *slot(Symbol const *symbol)
+    {
+        for (auto i = env_.size(); i != frame_base_; --i) {
+            if (env_[i - 1].first == symbol) {
+                return &env_[i - 1].second;
+            }
+        }
+        throw Abort{}; // A global, or not analyzed
+    }
+
+    void step()
+    {
+        if (steps_left_ == 0) {
+            throw Abort{};
+        }
+        --steps_left_;
+    }
+
+    ConstantEvaluator *owner_;
+    std::size_t steps_left_;
+    std::size_t depth_{};
+    std::vector<std::pair<Symbol const *, std::int64_t>> env_;
+    std::size_t frame_base_{}; // Where the variables of the current call begin
+    std::int64_t returned_{};
+};
+
+semantic::ConstantEvaluator::ConstantEvaluator(std::size_t step_budget)
+    : step_budget_(step_budget)
+{
+}
+
+semantic::ConstantEvaluator::~ConstantEvaluator() = default;
+
+void semantic::ConstantEvaluator::visit(ast::Program &prog)
+{
+    purity_ = std::make_unique<PurityAnalysis>(prog);
+    RecursiveNodeVisitor::visit(prog);
+}
+
+void semantic::ConstantEvaluator::visit(ast::VariableDeclaration &vd)
+{
+    if (vd.init()) {
+        fold(vd, *vd.init());
+    }
+}
+
+void semantic::ConstantEvaluator::visit(ast::ExpressionStatement &es)
+{
+    fold(es, *es.expr());
+}
+
+void semantic::ConstantEvaluator::visit(ast::ReturnStatement &rs)
+{
+    if (rs.returned_value()) {
+        fold(rs, *rs.returned_value());
+    }
+}
+
+void semantic::ConstantEvaluator::visit(ast::IfStatement &is)
+{
+    fold(is, *is.condition());
+    is.true_branch()->accept(*this);
+    if (is.false_branch()) {
+        is.false_branch()->accept(*this);
+    }
+}
+
+void semantic::ConstantEvaluator::visit(ast::WhileStatement &ws)
+{
+    fold(ws, *ws.condition());
+    ws.body()->accept(*this);
+}
+
+void semantic::ConstantEvaluator::fold(ast::Node &parent, ast::Expression &expr)
+{
+    if (auto *ce = dynamic_cast<ast::CallExpression *>(&expr)) {
+        for (auto const &arg : ce->arguments()) {
+            fold(*ce, *arg);
+        }
+        if (auto value = evaluate(*ce)) {
+            parent.replace_child(
+                *ce, ast::IntegerLiteralExpr::make(*value, ce->type(),
+                                                   ce->source_range()));
+            ++stats_.folded;
+        }
+    }
+    else if (auto *ue = dynamic_cast<ast::UnaryExpression *>(&expr)) {
+        fold(*ue, *ue->expr());
+    }
+    else if (auto *be = dynamic_cast<ast::BinaryExpression *>(&expr)) {
+        fold(*be, *be->lhs());
+        fold(*be, *be->rhs());
+    }
+    else if (auto *ie = dynamic_cast<ast::IndexExpression *>(&expr)) {
+        fold(*ie, *ie->base());
+        fold(*ie, *ie->index());
+    }
+}
+
+std::optional<std::int64_t>
+semantic::ConstantEvaluator::evaluate(ast::CallExpression &ce)
+{
+    auto *type = ce.type();
+    if (type == nullptr || type->typekind != TypeKind::builtin_type ||
+        static_cast<BuiltinType *>(type)->builintypekind !=
+            BuiltinType::Kind::integer_type) {
+        return std::nullopt;
+    }
+
+    // Arguments must be constant, i.e. evaluable without any variable
+    Machine machine(this);
+    try {
+        return machine.eval(ce);
+    }
+    catch (Machine::Abort const &) {
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <ast/ast.h>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace semantic {
+
+class PurityAnalysis;
+struct Symbol;
+
+/// @brief Evaluates calls of pure functions with constant arguments at
+/// compile time, replacing each such call by an integer literal.
+///
+/// Runs on a program the SemanticAnalyzer has annotated. Only integer
+/// computations are evaluated; a call that needs anything else, or more than
+/// `step_budget` steps, is left alone. Results are memoized per function and
+/// arguments, across call sites and for the recursive calls made while
+/// evaluating.
+class ConstantEvaluator : public ast::RecursiveNodeVisitor {
+  public:
+    struct Stats {
+        std::size_t folded{};    // Call sites replaced
+        std::size_t evaluated{}; // Calls actually executed
+        std::size_t memo_hits{};
+    };
+
+    static constexpr std::size_t default_step_budget = 1'000'000;
+
+    explicit ConstantEvaluator(std::size_t step_budget = default_step_budget);
+    ConstantEvaluator(ConstantEvaluator const &) = delete;
+    ConstantEvaluator(ConstantEvaluator &&) = delete;
+    ConstantEvaluator &operator=(ConstantEvaluator const &) = delete;
+    ConstantEvaluator &operator=(ConstantEvaluator &&) = delete;
+    ~ConstantEvaluator() override;
+
+    void visit(ast::Program &prog) override;
+    void visit(ast::VariableDeclaration &vd) override;
+    void visit(ast::ExpressionStatement &es) override;
+    void visit(ast::ReturnStatement &rs) override;
+    void visit(ast::IfStatement &is) override;
+    void visit(ast::WhileStatement &ws) override;
+
+    [[nodiscard]] Stats const &stats() const
+    {
+        return stats_;
+    }
+
+  private:
+    class Machine;
+
+    /// @brief Folds the calls in `expr`, a child of `parent`, bottom-up.
+    void fold(ast::Node &parent, ast::Expression &expr);
+
+    std::optional<std::int64_t> evaluate(ast::CallExpression &ce);
+
+    std::size_t step_budget_;
+    std::unique_ptr<PurityAnalysis> purity_;
+    std::map<std::pair<ast::FunctionDeclaration const *,
+                       std::vector<std::int64_t>>,
+             std::int64_t>
+        memo_;
+    Stats stats_;
+};
+
+} // namespace semantic
@@ -1,11 +1,64 @@
 #pragma once
+#include <memory>
+#include <mutex>
 #include <ranges>
+#include <semantic/arena.h>
+#include <semantic/name-table.h>
 #include <semantic/scope.h>
 
 namespace semantic {
 
 class Context {
   public:
+    Context() : types_(std::make_shared<TypeInterner>()) {}
+
+    /// @brief A child context, confined to one thread, for analyzing a
+    /// function body while the parent stays in its global scope.
+    ///
+    /// The child shares the parent's types and resolves names it doesn't know
+    /// against the parent, which must not be modified meanwhile.
+    explicit Context(Context *parent) : parent_(parent), types_(parent->types_)
+    {
+    }
+
+    Context(Context const &) = delete;
+    Context(Context &&) = delete;
+    Context &operator=(Context const &) = delete;
+    Context &operator=(Context &&) = delete;
+    ~Context() = default;
+
+    /// @brief Makes a child context owned by this one. Not thread-safe: make
+    /// the children before handing them out to worker threads.
+    Context *make_child()
+    {
+        return children_.emplace_back(std::make_unique<Context>(this)).get();
+    }
+
+    /// @brief Destroys a child made by make_child(), first unlinking its
+    /// scopes from ours.
+    void remove_child(Context *child)
+    {
+        {
+            std::scoped_lock lock(mutex_);
+            for (auto *scope : child->linked_scopes_) {
+                scope->parent()->remove_child(scope);
+            }
+        }
+        std::erase_if(children_, [child](auto const &c) {
+            return c.get() == child;
+        });
+    }
+
+    [[nodiscard]] Context *parent() const
+    {
+        return parent_;
+    }
+
+    TypeInterner *types()
+    {
+        return types_.get();
+    }
+
     Scope *current_scope()
     {
         return current_scope_;
@@ -13,8 +66,21 @@ class Context {
 
     void push_scope()
     {
-        scopes_.push_back(std::make_unique<Scope>(current_scope_));
-        current_scope_ = scopes_.back().get();
+        if (current_scope_ == nullptr && parent_ != nullptr) {
+            // Links to the parent's scope, which is shared with siblings
+            std::scoped_lock lock(parent_->mutex_);
+            scopes_.push_back(
+                arena_.make<Scope>(parent_->current_scope(), types(), &arena_));
+            if (scopes_.back()->parent() != nullptr) {
+                linked_scopes_.push_back(scopes_.back());
+            }
+        }
+        else {
+            scopes_.push_back(
+                arena_.make<Scope>(current_scope_, types(), &arena_));
+        }
+        current_scope_ = scopes_.back();
+        names_.enter_scope();
     }
 
     void pop_scope()
@@ -22,26 +88,58 @@ class Context {
         if (current_scope_ == nullptr) {
             throw std::runtime_error("No scope to pop");
         }
+        names_.leave_scope();
         current_scope_ = current_scope_->parent();
     }
 
-    void define_builtin_type(std::string const &name, BuiltinType const &type)
+    /// @brief Defines a symbol in the current scope. Returns nullptr if the
+    /// current scope already has a symbol of that name.
+    Symbol *define_symbol(Symbol symbol)
+    {
+        spdlog::debug("Defining symbol '{}'", symbol.name);
+        if (names_.lookup_local(symbol.name) != nullptr) {
+            return nullptr;
+        }
+        auto *s = arena_.make<Symbol>(std::move(symbol));
+        names_.define(s->name, s);
+        current_scope_->add_symbol(s);
+        return s;
+    }
+
+    /// @brief Resolves a name against the current scope and its enclosing
+    /// scopes.
+    [[nodiscard]] Symbol *lookup_symbol(std::string const &name) const
+    {
+        if (auto *s = names_.lookup(name)) {
+            return s;
+        }
+        return parent_ != nullptr ? parent_->lookup_symbol(name) : nullptr;
+    }
+
+    /// @brief Resolves a name against the current scope only.
+    [[nodiscard]] Symbol *lookup_local_symbol(std::string const &name) const
     {
-        builtin_types_.insert({name, type});
+        return names_.lookup_local(name);
+    }
+
+    void define_builtin_type(std::string const &name, BuiltinType::Kind kind,
+                             std::size_t size)
+    {
+        builtin_types_.insert({name, types_->builtin_type(kind, size)});
     }
 
     Type *find_builtin_type(std::string const &name)
     {
         if (auto it = builtin_types_.find(name); it != builtin_types_.end()) {
-            return &it->second;
+            return it->second;
         }
-        return nullptr;
+        return parent_ != nullptr ? parent_->find_builtin_type(name) : nullptr;
     }
 
     Type *get_builtin_type(std::string const &name)
     {
-        if (auto it = builtin_types_.find(name); it != builtin_types_.end()) {
-            return &it->second;
+        if (auto *p = find_builtin_type(name)) {
+            return p;
         }
         throw std::runtime_error(
             std::format("Builtin type '{}' not found", name));
@@ -53,20 +151,38 @@ class Context {
         spdlog::debug("{}Builtin Types:", indent_string(indent + 1));
         for (auto const &[name, type] : builtin_types_) {
             spdlog::debug("{}    {}: size={}, typekind={}",
-                          indent_string(indent + 1), name, type.type_size,
-                          to_string(type.typekind));
+                          indent_string(indent + 1), name, type->type_size,
+                          to_string(type->typekind));
+        }
+        if (parent_ == nullptr) {
+            types_->dump(indent + 1);
         }
         spdlog::debug("{}Scopes:", indent_string(indent + 1));
         for (auto const &[i, scope] : std::views::enumerate(scopes_)) {
             scope->dump(indent + 2);
         }
+        for (auto const &child : children_) {
+            child->dump(indent + 1);
+        }
     }
 
   private:
+    // Owns the scopes and symbols. Declared first, so that it outlives
+    // everything pointing into it.
+    Arena arena_;
+
+    Context *parent_{};
+    std::vector<std::unique_ptr<Context>> children_;
+    std::mutex mutex_; // Guards scopes shared with children
+
     Scope *current_scope_{};
-    std::vector<std::unique_ptr<Scope>> scopes_;
+    std::vector<Scope *> scopes_;
+    std::vector<Scope *> linked_scopes_; // Children of the parent's scopes
+
+    NameTable names_;
 
-    std::unordered_map<std::string, BuiltinType> builtin_types_;
+    std::shared_ptr<TypeInterner> types_;
+    std::unordered_map<std::string, BuiltinType *> builtin_types_;
 };
 
 } // namespace semantic
@@ -0,0 +1,413 @@
+#include <semantic/continuation-interpreter.h>
+
+#include <ast/ast.h>
+#include <semantic/operators.h>
+#include <semantic/scope.h>
+#include <semantic/symbol.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+semantic::ContinuationInterpreter::ContinuationInterpreter(
+    Diagnostics *diags, std::size_t max_depth)
+    : diags_(diags), max_depth_(max_depth)
+{
+}
+
+std::optional<semantic::Value>
+semantic::ContinuationInterpreter::run(ast::Program &prog)
+{
+    continuations_.clear();
+    operands_.clear();
+    stack_.clear(); // Frames a failed run left
+    failed_ = false;
+
+    globals_.assign(prog.global_frame_size(), Value{});
+    for (auto const &d : prog.declaration_statements()) {
+        d->accept(*this);
+        drain();
+        if (failed_) {
+            return std::nullopt;
+        }
+    }
+
+    auto *symbol = prog.global_scope()->lookup_symbol("main");
+    if (symbol == nullptr) {
+        diags_->error("Cannot find 'main'. Did you forget to define it?");
+        return std::nullopt;
+    }
+    if (symbol->symbolkind != SymbolKind::variable ||
+        symbol->type_ptr->typekind != TypeKind::function_type) {
+        diags_->error("'main' is not a function, its type: {}",
+                      to_string(symbol->type_ptr->typekind));
+        return std::nullopt;
+    }
+    auto *main = static_cast<FunctionType *>(symbol->type_ptr)->decl;
+    call(main, 0, *main, false);
+    drain();
+    if (failed_) {
+        return std::nullopt;
+    }
+    return pop();
+}
+
+void semantic::ContinuationInterpreter::drain()
+{
+    while (!continuations_.empty() && !failed_) {
+        step();
+    }
+}
+
+void semantic::ContinuationInterpreter::step()
+{
+    // Starting a child may reallocate the continuations, so `c` is only
+    // used before that.
+    auto &c = continuations_.back();
+    switch (c.kind) {
+    case Kind::compound: {
+        auto &statements = static_cast<ast::CompoundStatement *>(c.node)
+                               ->statements();
+        if (c.step == statements.size()) {
+            continuations_.pop_back();
+            return;
+        }
+        statements[c.step++]->accept(*this);
+        return;
+    }
+    case Kind::declaration: {
+        auto *vd = static_cast<ast::VariableDeclaration *>(c.node);
+        continuations_.pop_back();
+        variable(vd->symbol()) = pop();
+        return;
+    }
+    case Kind::expression_statement:
+        continuations_.pop_back();
+        operands_.pop_back();
+        return;
+    case Kind::returned:
+        return_from_function();
+        return;
+    case Kind::if_statement: {
+        auto *is = static_cast<ast::IfStatement *>(c.node);
+        continuations_.pop_back();
+        auto const &branch =
+            pop().as_int() != 0 ? is->true_branch() : is->false_branch();
+        if (branch) {
+            branch->accept(*this);
+        }
+        return;
+    }
+    case Kind::while_statement: {
+        auto *ws = static_cast<ast::WhileStatement *>(c.node);
+        if (c.step == 1) { // The body ran
+            c.step = 0;
+            ws->condition()->accept(*this);
+        }
+        else if (pop().as_int() != 0) {
+            c.step = 1;
+            ws->body()->accept(*this);
+        }
+        else {
+            continuations_.pop_back();
+        }
+        return;
+    }
+    case Kind::call:
+    case Kind::tail_call: {
+        auto *ce = static_cast<ast::CallExpression *>(c.node);
+        auto const &args = ce->arguments();
+        if (c.step < args.size()) {
+            args[c.step++]->accept(*this);
+            return;
+        }
+        call(ce->target(), args.size(), *ce, c.kind == Kind::tail_call);
+        return;
+    }
+    case Kind::function:
+        operands_.emplace_back(); // Ran off the end
+        return_from_function();
+        return;
+    case Kind::print:
+        continuations_.pop_back();
+        spdlog::info("Program printing: {}", pop().to_string());
+        operands_.emplace_back(std::int64_t{});
+        return;
+    case Kind::index: {
+        auto *ie = static_cast<ast::IndexExpression *>(c.node);
+        if (c.step++ == 0) {
+            ie->index()->accept(*this);
+            return;
+        }
+        continuations_.pop_back();
+        if (auto e = pop_element(*ie)) {
+            operands_.push_back(e->array->rows != nullptr
+                                    ? Value{e->array->rows + e->index}
+                                    : e->array->data[e->index]);
+        }
+        return;
+    }
+    case Kind::unary: {
+        auto *ue = static_cast<ast::UnaryExpression *>(c.node);
+        continuations_.pop_back();
+        operands_.back() = apply_unary(ue->opcode(), operands_.back());
+        return;
+    }
+    case Kind::binary: {
+        // The right operand first, as in the Intepreter
+        auto *be = static_cast<ast::BinaryExpression *>(c.node);
+        if (c.step++ == 0) {
+            be->lhs()->accept(*this);
+            return;
+        }
+        continuations_.pop_back();
+        auto lhs = pop();
+        auto result = apply_binary(be->opcode(), lhs, operands_.back());
+        if (!result.has_value()) {
+            fail("{}: Division by zero", be->source_range());
+            return;
+        }
+        operands_.back() = *result;
+        return;
+    }
+    case Kind::assignment: {
+        // The value, then the array and the index of an element; the value
+        // stays as that of the assignment
+        auto *be = static_cast<ast::BinaryExpression *>(c.node);
+        if (auto *id = dynamic_cast<ast::IdentifierExpression *>(
+                be->lhs().get())) {
+            continuations_.pop_back();
+            variable(id->symbol()) = operands_.back();
+            return;
+        }
+        auto *ie = dynamic_cast<ast::IndexExpression *>(be->lhs().get());
+        if (ie == nullptr) {
+            fail("{}: Left-hand side of assignment expression not an lvalue",
+                 be->source_range());
+            return;
+        }
+        switch (c.step++) {
+        case 0:
+            ie->base()->accept(*this);
+            return;
+        case 1:
+            ie->index()->accept(*this);
+            return;
+        default:
+            continuations_.pop_back();
+            // Rows aren't assignable, see SemanticAnalyzer
+            if (auto e = pop_element(*ie)) {
+                e->array->data[e->index] = operands_.back();
+            }
+            return;
+        }
+    }
+    }
+    throw std::logic_error{"Invalid continuation kind"};
+}
+
+void semantic::ContinuationInterpreter::call(ast::FunctionDeclaration *fd,
+                                             std::size_t arg_count,
+                                             ast::Node const &site, bool tail)
+{
+    // The arguments become the first slots of the frame
+    for (auto i = operands_.size() - arg_count; i < operands_.size(); ++i) {
+        stack_.push(operands_[i]);
+    }
+    operands_.resize(operands_.size() - arg_count);
+
+    if (tail) {
+        while (continuations_.back().kind != Kind::function) {
+            continuations_.pop_back();
+        }
+        release_frame_arrays(continuations_.back());
+        continuations_.back().node = fd;
+        stack_.replace(fd->frame_size(), arg_count);
+    }
+    else {
+        if (stack_.depth() >= max_depth_) {
+            fail("{}: Stack overflow calling '{}', more than {} calls deep",
+                 site.source_range(), fd->name(), max_depth_);
+            return;
+        }
+        if (!continuations_.empty() &&
+            continuations_.back().kind == Kind::call) {
+            continuations_.pop_back();
+        }
+        push(Kind::function, *fd);
+        stack_.enter(fd->frame_size(), arg_count);
+    }
+    fd->body()->accept(*this);
+}
+
+void semantic::ContinuationInterpreter::return_from_function()
+{
+    while (continuations_.back().kind != Kind::function) {
+        continuations_.pop_back();
+    }
+    release_frame_arrays(continuations_.back());
+    continuations_.pop_back();
+    stack_.leave();
+}
+
+void semantic::ContinuationInterpreter::release_frame_arrays(
+    Continuation const &function)
+{
+    auto const *fd = static_cast<ast::FunctionDeclaration *>(function.node);
+    for (auto slot : fd->frame_arrays()) {
+        arrays_.release(stack_[slot]);
+    }
+}
+
+std::optional<semantic::ContinuationInterpreter::Element>
+semantic::ContinuationInterpreter::pop_element(ast::IndexExpression const &ie)
+{
+    auto index = pop().as_int();
+    auto *array = pop().as_array();
+    if (array == nullptr || index < 0 ||
+        std::cmp_greater_equal(index, array->length)) {
+        fail("{}: Index {} out of bounds", ie.source_range(), index);
+        return std::nullopt;
+    }
+    return Element{.array = array, .index = static_cast<std::size_t>(index)};
+}
+
+void semantic::ContinuationInterpreter::visit(ast::VariableDeclaration &vd)
+{
+    if (vd.init()) {
+        push(Kind::declaration, vd);
+        vd.init()->accept(*this);
+    }
+    else {
+        auto &value = variable(vd.symbol());
+        if (vd.owns_array()) {
+            arrays_.release(value); // Of the last run
+        }
+        value = make_value(vd.resolved_type());
+    }
+}
+
+void semantic::ContinuationInterpreter::visit(
+    ast::FunctionDeclaration & /*unused*/)
+{
+}
+
+void semantic::ContinuationInterpreter::visit(ast::CompoundStatement &cs)
+{
+    push(Kind::compound, cs);
+}
+
+void semantic::ContinuationInterpreter::visit(ast::DeclarationStatement &ds)
+{
+    ds.declaration()->accept(*this);
+}
+
+void semantic::ContinuationInterpreter::visit(ast::ExpressionStatement &es)
+{
+    push(Kind::expression_statement, es);
+    es.expr()->accept(*this);
+}
+
+void semantic::ContinuationInterpreter::visit(ast::ReturnStatement &rs)
+{
+    // Calls in tail position reuse the frame, see call()
+    if (auto *ce = dynamic_cast<ast::CallExpression *>(
+            rs.returned_value().get());
+        ce != nullptr && ce->target() != nullptr) {
+        push(Kind::tail_call, *ce);
+        return;
+    }
+    push(Kind::returned, rs);
+    if (rs.returned_value()) {
+        rs.returned_value()->accept(*this);
+    }
+    else {
+        operands_.emplace_back(); // No value, as in the VM
+    }
+}
+
+void semantic::ContinuationInterpreter::visit(ast::IfStatement &is)
+{
+    push(Kind::if_statement, is);
+    is.condition()->accept(*this);
+}
+
+void semantic::ContinuationInterpreter::visit(ast::WhileStatement &ws)
+{
+    push(Kind::while_statement, ws);
+    ws.condition()->accept(*this);
+}
+
+void semantic::ContinuationInterpreter::visit(ast::CallExpression &ce)
+{
+    if (ce.builtin() == Builtin::print) {
+        push(Kind::print, ce);
+        ce.arguments().front()->accept(*this);
+        return;
+    }
+    if (ce.target() == nullptr) {
+        throw std::logic_error{"Call not resolved"};
+    }
+    push(Kind::call, ce);
+}
+
+void semantic::ContinuationInterpreter::visit(ast::IndexExpression &ie)
+{
+    push(Kind::index, ie);
+    ie.base()->accept(*this);
+}
+
+void semantic::ContinuationInterpreter::visit(ast::UnaryExpression &ue)
+{
+    push(Kind::unary, ue);
+    ue.expr()->accept(*this);
+}
+
+void semantic::ContinuationInterpreter::visit(ast::BinaryExpression &be)
+{
+    push(be.opcode() == OpCode::assign ? Kind::assignment : Kind::binary, be);
+    be.rhs()->accept(*this);
+}
+
+void semantic::ContinuationInterpreter::visit(ast::IdentifierExpression &ie)
+{
+    operands_.push_back(variable(ie.symbol()));
+}
+
+void semantic::ContinuationInterpreter::visit(ast::IntegerLiteralExpr &ie)
+{
+    operands_.emplace_back(ie.value());
+}
+
+void semantic::ContinuationInterpreter::visit(ast::FloatLiteralExpr &fe)
+{
+    operands_.emplace_back(std::stod(fe.value()));
+}
+
+void semantic::ContinuationInterpreter::visit(ast::StringLiteralExpr &se)
+{
+    operands_.emplace_back(strings_.intern(se.value()));
+}
+
+semantic::Value &
+semantic::ContinuationInterpreter::variable(Symbol const *symbol)
+{
+    switch (symbol->storage) {
+    case StorageKind::global:
+        return globals_[symbol->slot];
+    case StorageKind::local:
+        return stack_[symbol->slot];
+    case StorageKind::none:
+        break;
+    }
+    throw std::logic_error(
+        std::format("'{}' has no storage", symbol->name));
+}
+
+semantic::Value semantic::ContinuationInterpreter::make_value(Type *type)
+{
+    if (type == nullptr || type->typekind != TypeKind::array_type) {
+        return {};
+    }
+    return Value{arrays_.make(static_cast<ArrayType *>(type)->dimensions())};
+}
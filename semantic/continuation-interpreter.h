@@ -0,0 +1,156 @@
+#pragma once
+#include <ast/recursive-node-visitor.h>
+#include <cstddef>
+#include <cstdint>
+#include <diagnostics.h>
+#include <format>
+#include <optional>
+#include <semantic/call-stack.h>
+#include <semantic/symbol.h>
+#include <semantic/type.h>
+#include <semantic/value.h>
+#include <utility>
+#include <vector>
+
+namespace semantic {
+
+/// @brief Runs programs as the Intepreter does, but without native recursion,
+/// so that hlvm calls may nest millions deep.
+///
+/// What remains to be done is kept on a heap-allocated stack of
+/// continuations, each a node being executed and how far it got. Visiting a
+/// node starts it: leaves push their value on the operand stack, other nodes
+/// push their continuation and start their first child. The run loop then
+/// resumes the continuation on top whenever the one above it is done. A
+/// return drops the continuations up to that of its function. Frames live on
+/// a CallStack as in the Intepreter; calls nested deeper than `max_depth`
+/// are reported as a stack overflow.
+///
+/// Run-time errors end the run. Profiling, sampling and memoization are left
+/// to the Intepreter.
+class ContinuationInterpreter : public ast::RecursiveNodeVisitor {
+  public:
+    static constexpr std::size_t default_max_depth = 1 << 22;
+
+    explicit ContinuationInterpreter(
+        Diagnostics *diags, std::size_t max_depth = default_max_depth);
+
+    /// @brief Runs `prog`, which the SemanticAnalyzer has annotated without
+    /// errors. Returns what 'main' returns, or nullopt after reporting an
+    /// error.
+    std::optional<Value> run(ast::Program &prog);
+
+    void visit(ast::VariableDeclaration &vd) override;
+    void visit(ast::FunctionDeclaration &fd) override;
+
+    void visit(ast::CompoundStatement &cs) override;
+    void visit(ast::DeclarationStatement &ds) override;
+    void visit(ast::ExpressionStatement &es) override;
+    void visit(ast::ReturnStatement &rs) override;
+    void visit(ast::IfStatement &is) override;
+    void visit(ast::WhileStatement &ws) override;
+
+    void visit(ast::CallExpression &ce) override;
+    void visit(ast::IndexExpression &ie) override;
+    void visit(ast::UnaryExpression &ue) override;
+    void visit(ast::BinaryExpression &be) override;
+    void visit(ast::IdentifierExpression &ie) override;
+    void visit(ast::IntegerLiteralExpr &ie) override;
+    void visit(ast::FloatLiteralExpr &fe) override;
+    void visit(ast::StringLiteralExpr &se) override;
+
+  private:
+    // What each kind resumes after, i.e. once the children it started are
+    // done
+    enum class Kind : unsigned char {
+        compound,             // step: index of the next statement
+        declaration,          // Initializer evaluated
+        expression_statement, // Expression evaluated
+        returned,             // Returned value evaluated
+        if_statement,         // Condition evaluated
+        while_statement,      // step: 0 after the condition, 1 after the body
+        call,                 // step: index of the next argument
+        tail_call,            // Same, for a call in a return statement
+        function,             // Body ran to its end without returning
+        print,                // Argument evaluated
+        index,                // step: 0 after the array, 1 after the index
+        unary,                // Operand evaluated
+        binary,               // step: 0 after the right operand, 1 after both
+        assignment,           // step: 0 after the value, then as index
+    };
+
+    struct Continuation {
+        Kind kind;
+        std::uint32_t step;
+        ast::Node *node;
+    };
+
+    void push(Kind kind, ast::Node &node)
+    {
+        continuations_.push_back({.kind = kind, .step = 0, .node = &node});
+    }
+
+    Value pop()
+    {
+        auto value = operands_.back();
+        operands_.pop_back();
+        return value;
+    }
+
+    /// @brief Runs continuations until none is left or an error is
+    /// reported.
+    void drain();
+
+    /// @brief Resumes the continuation on top.
+    void step();
+
+    /// @brief Calls `fd` with the `arg_count` values on top of the operand
+    /// stack. A tail call replaces the frame and the continuations of the
+    /// innermost function; otherwise the call continuation on top, if any,
+    /// becomes that of `fd`.
+    void call(ast::FunctionDeclaration *fd, std::size_t arg_count,
+              ast::Node const &site, bool tail);
+
+    /// @brief Ends the innermost function, leaving the value on top of the
+    /// operand stack as its result.
+    void return_from_function();
+
+    /// @brief Frees the arrays dying with the frame of `function`, the
+    /// innermost function continuation.
+    void release_frame_arrays(Continuation const &function);
+
+    struct Element {
+        Array *array;
+        std::size_t index;
+    };
+
+    /// @brief Pops the index and the array of `ie`, and returns them, or
+    /// nullopt after reporting the index out of bounds.
+    std::optional<Element> pop_element(ast::IndexExpression const &ie);
+
+    Value &variable(Symbol const *symbol);
+
+    /// @brief Makes the initial value of a variable of `type`.
+    Value make_value(Type *type);
+
+    /// @brief Reports an error and ends the run.
+    template <typename... Ts>
+    void fail(std::format_string<Ts...> fmt, Ts &&...ts)
+    {
+        diags_->error(fmt, std::forward<Ts>(ts)...);
+        failed_ = true;
+    }
+
+    Diagnostics *diags_;
+    std::size_t max_depth_;
+    std::vector<Continuation> continuations_;
+    std::vector<Value> operands_;
+    CallStack stack_;
+    std::vector<Value> globals_; // Indexed by slot
+    bool failed_{};
+
+    StringPool strings_;
+    ArrayPool arrays_;
+};
+
+} // namespace semantic
@@ -0,0 +1,192 @@
+#include <semantic/escape.h>
+
+#include <ast/parallel-function-visitor.h>
+#include <ast/recursive-node-visitor.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <semantic/symbol.h>
+#include <semantic/type.h>
+#include <vector>
+
+namespace {
+
+bool is_array(semantic::Type const *type)
+{
+    return type != nullptr && type->typekind == semantic::TypeKind::array_type;
+}
+
+/// Records how a function body uses the arrays of its frame. An expression
+/// is visited knowing what its value is used for, and an array variable
+/// takes the use of the expressions that yield it or a row of it.
+class ArrayUses : public ast::RecursiveNodeVisitor {
+  public:
+    struct Argument {
+        semantic::Symbol const *symbol;
+        ast::FunctionDeclaration const *callee;
+        std::size_t index;
+    };
+
+    void visit(ast::FunctionDeclaration & /*unused*/) override
+    {
+        // Analyzed on its own
+    }
+
+    void visit(ast::VariableDeclaration &vd) override
+    {
+        declarations.push_back(&vd);
+        RecursiveNodeVisitor::visit(vd);
+    }
+
+    void visit(ast::ReturnStatement &rs) override
+    {
+        in_return_ = true;
+        RecursiveNodeVisitor::visit(rs);
+        in_return_ = false;
+    }
+
+    void visit(ast::IdentifierExpression &ie) override
+    {
+        auto const *s = ie.symbol();
+        if (s == nullptr || s->storage != semantic::StorageKind::local ||
+            !is_array(s->type_ptr)) {
+            return;
+        }
+        switch (use_) {
+        case Use::inspected:
+            break;
+        case Use::argument:
+            arguments.push_back(
+                {.symbol = s, .callee = callee_, .index = argument_});
+            break;
+        case Use::escapes:
+            escaping.push_back(s);
+            break;
+        }
+    }
+
+    void visit(ast::IndexExpression &ie) override
+    {
+        // A row is used as the expression itself is
+        auto use = use_;
+        with(is_array(ie.type()) ? use : Use::inspected, *ie.base());
+        with(Use::escapes, *ie.index());
+        use_ = use;
+    }
+
+    void visit(ast::CallExpression &ce) override
+    {
+        auto use = use_;
+        for (std::size_t i = 0; i < ce.arguments().size(); ++i) {
+            callee_ = ce.target();
+            argument_ = i;
+            if (ce.target() == nullptr) {
+                with(Use::inspected, *ce.arguments()[i]); // Printed
+            }
+            else {
+                with(in_return_ ? Use::escapes : Use::argument,
+                     *ce.arguments()[i]);
+            }
+        }
+        use_ = use;
+    }
+
+    void visit(ast::UnaryExpression &ue) override
+    {
+        auto use = use_;
+        with(Use::escapes, *ue.expr());
+        use_ = use;
+    }
+
+    void visit(ast::BinaryExpression &be) override
+    {
+        // Assigning to a whole array variable makes it alias another
+        auto use = use_;
+        with(Use::escapes, *be.lhs());
+        with(Use::escapes, *be.rhs());
+        use_ = use;
+    }
+
+    std::vector<ast::VariableDeclaration *> declarations;
+    std::vector<semantic::Symbol const *> escaping;
+    std::vector<Argument> arguments;
+
+  private:
+    enum class Use : unsigned char {
+        inspected, // Indexed or printed
+        argument,  // Passed to `callee_` as argument `argument_`
+        escapes,
+    };
+
+    void with(Use use, ast::Expression &expr)
+    {
+        use_ = use;
+        expr.accept(*this);
+    }
+
+    Use use_{Use::escapes};
+    bool in_return_{};
+    ast::FunctionDeclaration const *callee_{};
+    std::size_t argument_{};
+};
+
+} // namespace
+
+semantic::EscapeAnalysis::EscapeAnalysis(ast::Program &prog)
+{
+    struct Function {
+        ast::FunctionDeclaration *fd;
+        ArrayUses uses;
+    };
+    std::deque<Function> functions; // Visitors stay put
+    for (auto *fd : ast::function_declarations(prog)) {
+        auto &f = functions.emplace_back(fd);
+        for (auto const &stmt : fd->body()->statements()) {
+            stmt->accept(f.uses);
+        }
+        escaping_.insert(f.uses.escaping.begin(), f.uses.escaping.end());
+    }
+
+    // Arrays passed to parameters that escape escape too, until nothing
+    // changes
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto const &f : functions) {
+            for (auto const &arg : f.uses.arguments) {
+                auto const *param = arg.callee->parameters()[arg.index].symbol;
+                if (escaping_.contains(param) &&
+                    escaping_.insert(arg.symbol).second) {
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Slots are shared by variables of disjoint blocks. A slot holds only
+    // arrays to free if every variable in it owns the array it makes.
+    for (auto &f : functions) {
+        std::map<std::uint32_t, bool> owned; // By slot
+        for (auto const &param : f.fd->parameters()) {
+            owned[param.symbol->slot] = false;
+        }
+        auto owns = [this](ast::VariableDeclaration const *vd) {
+            return !vd->init() && is_array(vd->resolved_type()) &&
+                   !escaping_.contains(vd->symbol());
+        };
+        for (auto const *vd : f.uses.declarations) {
+            auto [it, _] = owned.try_emplace(vd->symbol()->slot, true);
+            it->second = it->second && owns(vd);
+        }
+        std::vector<std::uint32_t> frame_arrays;
+        for (auto const &[slot, all] : owned) {
+            if (all) {
+                frame_arrays.push_back(slot);
+            }
+        }
+        for (auto *vd : f.uses.declarations) {
+            vd->set_owns_array(owned[vd->symbol()->slot]);
+        }
+        f.fd->set_frame_arrays(std::move(frame_arrays));
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <ast/ast.h>
+#include <unordered_set>
+
+namespace semantic {
+
+struct Symbol;
+
+/// @brief Finds the local arrays of an analyzed program that die with the
+/// frame declaring them, so that engines can free them.
+///
+/// An array escapes if it may be reachable once its frame is left: it, or a
+/// row of it, is assigned, stored, returned, passed to a parameter that
+/// escapes, or passed in a return statement, whose call may reuse the frame.
+/// Indexing and printing it don't count. Parameters escape by the same rules,
+/// optimistically for recursion as in PurityAnalysis.
+///
+/// A declaration without an initializer that makes an array that doesn't
+/// escape is marked as owning it (VariableDeclaration::owns_array), and its
+/// slot is listed in the FunctionDeclaration::frame_arrays of its function
+/// unless a variable owning no array shares the slot.
+class EscapeAnalysis {
+  public:
+    /// @brief Analyzes `prog` and marks its declarations and functions.
+    explicit EscapeAnalysis(ast::Program &prog);
+
+    /// @brief Whether the array in a local variable or parameter may outlive
+    /// its frame.
+    [[nodiscard]] bool escapes(Symbol const *symbol) const
+    {
+        return escaping_.contains(symbol);
+    }
+
+  private:
+    std::unordered_set<Symbol const *> escaping_;
+};
+
+} // namespace semantic
@@ -0,0 +1,223 @@
+#include <semantic/incremental-analyzer.h>
+
+#include <ast/recursive-node-visitor.h>
+#include <diagnostics.h>
+#include <semantic/context.h>
+#include <semantic/semantic-analyzer.h>
+
+namespace {
+
+std::string const &declaration_name(ast::Declaration &decl)
+{
+    if (auto *fd = dynamic_cast<ast::FunctionDeclaration *>(&decl)) {
+        return fd->name();
+    }
+    return static_cast<ast::VariableDeclaration &>(decl).name();
+}
+
+/// Collects the names of all identifiers used in a subtree.
+class IdentifierCollector : public ast::RecursiveNodeVisitor {
+  public:
+    void visit(ast::IdentifierExpression &ie) override
+    {
+        names.insert(ie.name());
+    }
+
+    std::unordered_set<std::string> names;
+};
+
+/// Points calls at the current declarations of their callees. Replacing a
+/// function keeps its symbol but not its callers' resolved targets, when
+/// its signature is unchanged and they aren't reanalyzed.
+class CallRetargeter : public ast::RecursiveNodeVisitor {
+  public:
+    void visit(ast::CallExpression &ce) override
+    {
+        auto *s = ce.callee()->symbol();
+        if (ce.target() != nullptr && s != nullptr && s->type_ptr != nullptr &&
+            s->type_ptr->typekind == semantic::TypeKind::function_type) {
+            ce.set_target(static_cast<semantic::FunctionType *>(s->type_ptr)
+                              ->decl);
+        }
+        RecursiveNodeVisitor::visit(ce);
+    }
+};
+
+} // namespace
+
+semantic::IncrementalAnalyzer::IncrementalAnalyzer() = default;
+
+semantic::IncrementalAnalyzer::~IncrementalAnalyzer() = default;
+
+void semantic::IncrementalAnalyzer::analyze(ast::Program &prog,
+                                            Diagnostics *diags)
+{
+    std::vector<std::string> names;
+    for (auto const &ds : prog.decls_) {
+        names.push_back(declaration_name(*ds->declaration()));
+    }
+    if (ctx_ == nullptr || names != names_) {
+        names_ = std::move(names);
+        reset(prog);
+    }
+    prog.global_scope_ = ctx_->current_scope();
+    prog.global_frame_size_ = global_frame_size_;
+
+    for (auto const &ds : prog.decls_) {
+        auto *decl = ds->declaration().get();
+        db_->set_input(QueryKey{declaration, declaration_name(*decl)}, decl);
+    }
+
+    for (auto const &message : declaration_errors_) {
+        diags->report(message);
+    }
+    for (auto const &name : names_) {
+        if (!globals_.contains(name)) {
+            continue; // A duplicate
+        }
+        for (auto const &message :
+             db_->get<Signature>({signature, name}).diagnostics) {
+            diags->report(message);
+        }
+    }
+    for (auto const &name : names_) {
+        if (!globals_.contains(name) ||
+            !db_->get<Signature>({signature, name}).is_function) {
+            continue;
+        }
+        for (auto const &message :
+             db_->get<std::vector<std::string>>({function_body, name})) {
+            diags->report(message);
+        }
+    }
+
+    CallRetargeter retargeter;
+    prog.accept(retargeter);
+}
+
+void semantic::IncrementalAnalyzer::reset(ast::Program &prog)
+{
+    bodies_.clear();
+    globals_.clear();
+    declaration_errors_.clear();
+    global_frame_size_ = 0;
+    db_ = std::make_unique<QueryDatabase>();
+    ctx_ = std::make_unique<Context>();
+    define_queries();
+
+    Diagnostics diags(Diagnostics::Mode::buffered);
+    SemanticAnalyzer builtins(ctx_.get(), &diags); // Defines builtin types
+    ctx_->push_scope();
+
+    // Symbols of globals are typed by their signature queries
+    for (auto const &ds : prog.decls_) {
+        auto const &name = declaration_name(*ds->declaration());
+        auto *s = ctx_->define_symbol(
+            Symbol{.name = name,
+                   .type_ptr = nullptr,
+                   .symbolkind = SymbolKind::variable});
+        if (s == nullptr) {
+            declaration_errors_.push_back(
+                std::format("Global re-declaration error: {}", name));
+            continue;
+        }
+        if (dynamic_cast<ast::VariableDeclaration *>(
+                ds->declaration().get()) != nullptr) {
+            s->storage = StorageKind::global;
+            s->slot = global_frame_size_++;
+        }
+        globals_.insert({name, s});
+    }
+}
+
+void semantic::IncrementalAnalyzer::define_queries()
+{
+    db_->define_query<Signature>(signature, [this](QueryKey const &key) {
+        return std::any{compute_signature(key.subject)};
+    });
+    db_->define_query<std::vector<std::string>>(
+        function_body, [this](QueryKey const &key) {
+            return std::any{check_function_body(key.subject)};
+        });
+}
+
+semantic::IncrementalAnalyzer::Signature
+semantic::IncrementalAnalyzer::compute_signature(std::string const &name)
+{
+    auto *decl = declaration_of(name);
+    auto *symbol = globals_.at(name);
+    Diagnostics diags(Diagnostics::Mode::buffered);
+    Signature sig;
+
+    if (auto *fd = dynamic_cast<ast::FunctionDeclaration *>(decl)) {
+        SemanticAnalyzer analyzer(ctx_.get(), &diags);
+        sig.is_function = true;
+        sig.type = analyzer.resolve_type(fd->return_type().get());
+        for (auto const &param : fd->parameters()) {
+            sig.parameter_types.push_back(
+                analyzer.resolve_type(param.type.get()));
+        }
+        symbol->type_ptr =
+            ctx_->types()->function_type(sig.type, sig.parameter_types, fd);
+    }
+    else {
+        // Analyzed aside, as the global symbol exists already. Variables
+        // initialized from each other in a cycle see no type, an error.
+        auto &vd = static_cast<ast::VariableDeclaration &>(*decl);
+        symbol->type_ptr = nullptr;
+        if (auto const &init = vd.init()) {
+            resolving_.insert(name);
+            depend_on_globals(*init);
+            resolving_.erase(name);
+        }
+        auto *child = ctx_->make_child();
+        SemanticAnalyzer analyzer(child, &diags);
+        child->push_scope();
+        vd.accept(analyzer);
+        child->pop_scope();
+        ctx_->remove_child(child);
+        sig.type = vd.resolved_type();
+        symbol->type_ptr = sig.type;
+    }
+
+    decl->set_symbol(symbol);
+    sig.diagnostics = diags.take_messages();
+    return sig;
+}
+
+std::vector<std::string>
+semantic::IncrementalAnalyzer::check_function_body(std::string const &name)
+{
+    auto &fd = static_cast<ast::FunctionDeclaration &>(*declaration_of(name));
+    db_->get<Signature>({signature, name});
+    depend_on_globals(fd);
+
+    auto &body = bodies_[name];
+    if (body != nullptr) {
+        ctx_->remove_child(body);
+    }
+    body = ctx_->make_child();
+
+    Diagnostics diags(Diagnostics::Mode::buffered);
+    SemanticAnalyzer analyzer(body, &diags);
+    fd.accept(analyzer);
+    return diags.take_messages();
+}
+
+void semantic::IncrementalAnalyzer::depend_on_globals(ast::Node &node)
+{
+    // Locals shadowing a global only add a spurious dependency
+    IdentifierCollector collector;
+    node.accept(collector);
+    for (auto const &name : collector.names) {
+        if (globals_.contains(name) && !resolving_.contains(name)) {
+            db_->get<Signature>({signature, name});
+        }
+    }
+}
+
+ast::Declaration *
+semantic::IncrementalAnalyzer::declaration_of(std::string const &name)
+{
+    return db_->get<ast::Declaration *>({declaration, name});
+}
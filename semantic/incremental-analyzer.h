@@ -0,0 +1,93 @@
+#pragma once
+#include <ast/ast.h>
+#include <memory>
+#include <semantic/query-database.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class Diagnostics;
+
+namespace semantic {
+
+class Context;
+struct Symbol;
+struct Type;
+
+/// @brief Semantic analysis as memoized queries, for re-analyzing a program
+/// after edits.
+///
+/// Each top-level declaration is an input, identified by its node. Edits
+/// replace declarations (see ast::Program::replace_declaration), so the nodes
+/// of untouched declarations, and the facts computed for them, survive. The
+/// derived queries are the signature of a global, i.e. the type of its
+/// declaration, and the check of a function body, which depends on the
+/// signatures of the globals its identifiers resolve to. Global symbols are
+/// kept across runs and updated in place.
+///
+/// Adding, removing or reordering globals re-analyzes everything.
+class IncrementalAnalyzer {
+  public:
+    /// @brief The part of a global's type its users depend on.
+    struct Signature {
+        Type *type{}; // Of a variable, or the return type of a function
+        std::vector<Type *> parameter_types;
+        bool is_function{};
+        std::vector<std::string> diagnostics;
+
+        bool operator==(Signature const &) const = default;
+    };
+
+    IncrementalAnalyzer();
+    IncrementalAnalyzer(IncrementalAnalyzer const &) = delete;
+    IncrementalAnalyzer(IncrementalAnalyzer &&) = delete;
+    IncrementalAnalyzer &operator=(IncrementalAnalyzer const &) = delete;
+    IncrementalAnalyzer &operator=(IncrementalAnalyzer &&) = delete;
+    ~IncrementalAnalyzer();
+
+    /// @brief Brings the analysis of `prog` up to date and reports all its
+    /// errors to `diags`, including those of unchanged declarations.
+    void analyze(ast::Program &prog, Diagnostics *diags);
+
+    [[nodiscard]] Context *context() const
+    {
+        return ctx_.get();
+    }
+
+    [[nodiscard]] QueryDatabase::Stats const &stats() const
+    {
+        return db_->stats();
+    }
+
+  private:
+    enum QueryKind : std::uint32_t {
+        declaration, // Input
+        signature,
+        function_body,
+    };
+
+    void reset(ast::Program &prog);
+    void define_queries();
+
+    Signature compute_signature(std::string const &name);
+    std::vector<std::string> check_function_body(std::string const &name);
+
+    /// @brief Records dependencies on the signatures of the globals that
+    /// `node` refers to, bringing their symbols up to date.
+    void depend_on_globals(ast::Node &node);
+
+    ast::Declaration *declaration_of(std::string const &name);
+
+    std::unique_ptr<QueryDatabase> db_;
+    std::unique_ptr<Context> ctx_;
+
+    std::vector<std::string> names_; // Of the globals, in declaration order
+    std::unordered_map<std::string, Symbol *> globals_;
+    std::unordered_map<std::string, Context *> bodies_; // Per function
+    std::unordered_set<std::string> resolving_;         // Variables
+    std::vector<std::string> declaration_errors_;
+    std::uint32_t global_frame_size_{};
+};
+
+} // namespace semantic
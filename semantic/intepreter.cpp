@@ -1,46 +1,75 @@
 #include <ast/ast.h>
 #include <diagnostics.h>
-#include <functional>
 #include <iostream>
-#include <ranges>
+#include <semantic/completion.h>
 #include <semantic/context.h>
-#include <semantic/frame.h>
 #include <semantic/intepreter.h>
-#include <semantic/return-signal.h>
+#include <semantic/memoizer.h>
+#include <semantic/operators.h>
+#include <semantic/profiler.h>
+#include <semantic/sampling-profiler.h>
 #include <semantic/symbol.h>
 #include <spdlog/spdlog.h>
+#include <trace/trace.h>
 #include <utility>
 
+
 void semantic::Intepreter::dump(std::ostream &os)
 {
-    if (curr_frame_) {
-        std::vector<Frame *> frames;
-        frames.push_back(curr_frame_.get());
-        while (frames.back() != nullptr) {
-            frames.push_back(frames.back()->parent().get());
-        }
-        frames.pop_back(); // nullptr
-        for (auto i = frames.size() - 1; i != -1UZ; --i) {
-            frames[i]->dump(os, static_cast<int>(frames.size() - 1 - i));
-        }
+    if (stack_.depth() != 0) {
+        stack_.dump(os);
     }
     else {
         spdlog::debug("Currently doesn't in any frame.");
     }
 
     if (last_returned_.has_value()) {
-        spdlog::debug("Last returned value: {}", *last_returned_);
+        spdlog::debug("Last returned value: {}", last_returned_->to_string());
     }
     else {
         spdlog::debug("Didn't return from any function");
     }
 }
 
+void semantic::Intepreter::on_statement(ast::Statement const *s)
+{
+    if (profiler_ != nullptr) {
+        profiler_->count_statement(s);
+    }
+    if (sampler_ != nullptr) {
+        sampler_->at(s);
+    }
+}
+
+void semantic::Intepreter::on_enter(ast::FunctionDeclaration const *fd)
+{
+    if (profiler_ != nullptr) {
+        profiler_->enter(fd);
+    }
+    if (sampler_ != nullptr) {
+        sampler_->enter(fd);
+    }
+}
+
+void semantic::Intepreter::on_leave()
+{
+    if (profiler_ != nullptr) {
+        profiler_->leave();
+    }
+    if (sampler_ != nullptr) {
+        sampler_->leave();
+    }
+}
+
 void semantic::Intepreter::visit(ast::Program &p)
 {
+    completion_ = Completion::normal;
+    globals_.assign(p.global_frame_size(), Value{});
     for (auto const &d : p.declaration_statements()) {
-        spdlog::debug("Visiting declaration statements");
         d->accept(*this);
+        if (failed()) {
+            return;
+        }
     }
 
     auto *scope = p.global_scope();
@@ -50,243 +79,253 @@ void semantic::Intepreter::visit(ast::Program &p)
         diags_->error("Cannot find 'main'. Did you forget to define it?");
         return;
     }
-    enter_subframe();
-    try {
-        if (symbol->symbolkind != SymbolKind::variable ||
-            symbol->type_ptr->typekind != TypeKind::function_type) {
-            diags_->error("'main' is not a function, its type: {}",
-                          to_string(symbol->type_ptr->typekind));
-            return;
-        }
-        auto *ft = static_cast<FunctionType *>(symbol->type_ptr);
-        assert(ft && ft->decl && ft->decl->body());
-        ft->decl->body()->accept(*this);
+    if (symbol->symbolkind != SymbolKind::variable ||
+        symbol->type_ptr->typekind != TypeKind::function_type) {
+        diags_->error("'main' is not a function, its type: {}",
+                      to_string(symbol->type_ptr->typekind));
+        return;
     }
-    catch (ReturnSignal const &e) {
-        ;
+    auto *ft = static_cast<FunctionType *>(symbol->type_ptr);
+    assert(ft && ft->decl && ft->decl->body());
+    call(ft->decl, 0);
+    if (failed()) {
+        last_returned_.reset(); // Whatever returned before, main didn't
     }
 }
 
 void semantic::Intepreter::visit(ast::VariableDeclaration &vd)
 {
-    if (auto const &init = vd.init()) {
-        init->accept(*this);
-        curr_frame_->new_variable(vd.name(), last_visited_.value());
-    }
-    // else {
-    //     curr_frame->new_variable(vd.name(), "");
-    // }
-    // std::println("Defining variable {}", vd.name());
+    if (vd.owns_array()) {
+        arrays_.release(variable(vd.symbol())); // Of the last run
+    }
+    // Evaluated first, as calls may move the frame
+    auto value = vd.init() ? eval(vd.init()) : make_value(vd.resolved_type());
+    variable(vd.symbol()) = value;
 }
 
 void semantic::Intepreter::visit(ast::FunctionDeclaration & /*unused*/) {}
 
 void semantic::Intepreter::visit(ast::CompoundStatement &cs)
 {
-    spdlog::debug("Executing body of compound statement");
     for (auto const &s : cs.statements()) {
         s->accept(*this);
+        if (completion_ != Completion::normal) {
+            break;
+        }
     }
 }
 
 void semantic::Intepreter::visit(ast::DeclarationStatement &ds)
 {
-    spdlog::debug("{}: Executing declaration statement", ds.source_range());
+    HLVM_TRACE_EVENT(statement, ds.source_range(), 0);
+    on_statement(&ds);
     ds.declaration()->accept(*this);
 }
 
 // Leaving frame is responsibility of internal function body, not call itself.
 void semantic::Intepreter::visit(ast::CallExpression &ce)
 {
-    // Check if is a callable function
-    auto *callee_p =
-        dynamic_cast<ast::IdentifierExpression *>(ce.callee().get());
-    if (callee_p == nullptr) {
-        diags_->error(
-            "{}: Callee not an identifier, but we only support identifiers",
-            callee_p->source_range());
-        last_visited_.reset();
+    if (ce.builtin() == Builtin::print) {
+        auto value = eval(ce.arguments().front());
+        if (!failed()) {
+            spdlog::info("Program printing: {}", value.to_string());
+        }
+        last_visited_ = Value{std::int64_t{}};
         return;
     }
 
-    if (callee_p->name() == "print") {
-        spdlog::info("Program printing: {}", eval(ce.arguments().front()));
+    auto *decl = ce.target();
+    if (decl == nullptr) {
+        throw std::logic_error{"Call not resolved"};
+    }
+    HLVM_TRACE_EVENT(call, ce.source_range(), ce.arguments().size());
+    // Arguments are evaluated in the frame of the caller, and become the
+    // first slots of the callee's frame.
+    for (auto const &arg : ce.arguments()) {
+        stack_.push(eval(arg));
+    }
+    if (failed()) {
+        stack_.pop(ce.arguments().size());
+        last_visited_ = {};
         return;
     }
+    if (memoizer_ != nullptr && memoizer_->memoizes(decl)) {
+        call_memoized(decl, ce.arguments().size());
+        return;
+    }
+    call(decl, ce.arguments().size());
+}
 
-    auto *sym = callee_p->symbol();
-    if (sym == nullptr) {
-        throw std::logic_error("Symbol unbounded");
-        // diags_->error("{}: Undefined identifier '{}'",
-        // callee_p->source_range(),
-        //               callee_p->name());
-        // spdlog::error("Can find local symbol {}? {}", callee_p->name(),
-        //               ctx_->current_scope()->lookup_local_symbol(
-        //                   callee_p->name()) != nullptr);
-        // return;
+void semantic::Intepreter::call(ast::FunctionDeclaration *decl,
+                                std::size_t arg_count)
+{
+    stack_.enter(decl->frame_size(), arg_count);
+    on_enter(decl);
+    decl->body()->accept(*this);
+    while (completion_ == Completion::tail_call) {
+        on_leave();
+        release_frame_arrays(decl);
+        decl = tail_callee_;
+        stack_.replace(decl->frame_size(), decl->parameters().size());
+        completion_ = Completion::normal;
+        on_enter(decl);
+        decl->body()->accept(*this);
+    }
+    on_leave();
+    if (!failed()) {
+        completion_ = Completion::normal; // The return ends here
     }
-    if (sym->type_ptr->typekind != TypeKind::function_type) {
-        diags_->error("Callee '{}' not a function", callee_p->name());
+    release_frame_arrays(decl);
+    leave_frame();
+}
+
+void semantic::Intepreter::call_memoized(ast::FunctionDeclaration *decl,
+                                         std::size_t arg_count)
+{
+    auto args = stack_.top(arg_count);
+    auto cached = memoizer_->lookup(decl, args);
+    if (cached.has_value()) {
+        stack_.pop(arg_count);
+        last_visited_ = *cached;
         return;
     }
+    std::vector<Value> key(args.begin(), args.end());
+    call(decl, arg_count);
+    // A call that failed has no result to reuse
+    if (!failed()) {
+        memoizer_->insert(decl, key, last_visited_);
+    }
+}
 
-    spdlog::debug("{}: Executing function '{}'", ce.source_range(),
-                  callee_p->name());
-    enter_subframe();
-    auto *ft = static_cast<FunctionType *>(sym->type_ptr);
-    auto *decl = ft->decl;
-    // Sets parameters
-    spdlog::debug("Setting parameters");
-    for (auto const &[arg, param] :
-         std::views::zip(ce.arguments(), decl->parameters())) {
-        curr_frame_->new_variable(param.name, eval(arg));
-        spdlog::debug("Setting parameter {}={}", param.name,
-                      *curr_frame_->lookup_rvalue(param.name));
-    }
-    spdlog::debug("Parameters set");
-    // dump(std::cout);
-    // Invokes the function
-    try {
-        decl->body()->accept(*this);
+void semantic::Intepreter::visit(ast::IndexExpression &ie)
+{
+    auto e = element(&ie);
+    if (!e.has_value()) {
+        last_visited_ = {};
     }
-    catch (ReturnSignal const &e) {
-        // Doing nothing, because it's a signal to leave function
-        ;
+    else if (e->dimension->rows == nullptr) {
+        last_visited_ = e->array->data[e->offset];
+    }
+    else {
+        last_visited_ = Value{e->dimension->rows + e->offset};
     }
-    // leave_frame();
 }
 
 void semantic::Intepreter::visit(ast::IntegerLiteralExpr &ie)
 {
-    last_visited_ = ie.strvalue();
+    last_visited_ = Value{ie.value()};
 }
 
 void semantic::Intepreter::visit(ast::FloatLiteralExpr &fe)
 {
-    last_visited_ = fe.value();
+    last_visited_ = Value{std::stod(fe.value())};
 }
 
 void semantic::Intepreter::visit(ast::StringLiteralExpr &se)
 {
-    last_visited_ = se.value();
+    last_visited_ = Value{strings_.intern(se.value())};
 }
 
 void semantic::Intepreter::visit(ast::UnaryExpression &uoe)
 {
-    uoe.expr()->accept(*this);
-    auto value = std::stoll(*last_visited_);
-
-    auto const &op = uoe.op();
-    if (op == "+") {
-    }
-    else if (op == "-") {
-        value = -value;
-    }
-
-    last_visited_ = std::to_string(value);
+    last_visited_ = apply_unary(uoe.opcode(), eval(uoe.expr().get()));
 }
 
 void semantic::Intepreter::visit(ast::BinaryExpression &boe)
 {
-    auto rhs = std::stoll(eval(boe.rhs().get()));
-
-    auto const &op = boe.op();
-    auto execute = [&] {
-        switch (op.kind) {
-        case TokenKind::plus: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs + rhs;
-        }
-        case TokenKind::minus: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs - rhs;
-        }
-        case TokenKind::star: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs * rhs;
-        }
-        case TokenKind::slash: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs / rhs;
-        }
-        case TokenKind::percent: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs % rhs;
-        }
-        case TokenKind::equalequal: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs == rhs ? 1LL : 0LL;
-        }
-        case TokenKind::less: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs < rhs ? 1LL : 0LL;
-        }
-        case TokenKind::lessthan: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs <= rhs ? 1LL : 0LL;
-        }
-        case TokenKind::more: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs > rhs ? 1LL : 0LL;
-        }
-        case TokenKind::morethan: {
-            auto lhs = std::stoll(eval(boe.lhs().get()));
-            return lhs >= rhs ? 1LL : 0LL;
-        }
-        case TokenKind::equal: {
-            auto *pidentifier =
-                dynamic_cast<ast::IdentifierExpression *>(boe.lhs().get());
-            if (pidentifier == nullptr) {
-                diags_->error(
-                    "{}: Left-hand side of assignment expression not an "
-                    "identifier",
-                    boe.source_range());
-                last_visited_.reset();
-            }
-            auto *pvar = curr_frame_->lookup_lvalue(pidentifier->name());
-            *pvar = std::to_string(rhs);
-            return std::stoll(*pvar);
+    auto rhs = eval(boe.rhs().get());
+
+    if (boe.opcode() == OpCode::assign) {
+        auto *pvar = lvalue(boe.lhs().get());
+        if (failed()) {
+            last_visited_ = {};
+            return;
         }
-        default:
-            throw std::runtime_error(
-                std::format("Unknown binary operator {}", op.value));
+        if (pvar == nullptr) {
+            fail("{}: Left-hand side of assignment expression not an lvalue",
+                 boe.source_range());
+            last_visited_ = {};
+            return;
         }
-    };
+        *pvar = rhs;
+        last_visited_ = rhs;
+        return;
+    }
 
-    last_visited_ = std::to_string(execute());
+    auto lhs = eval(boe.lhs().get());
+    if (failed()) {
+        last_visited_ = {};
+        return;
+    }
+    auto result = apply_binary(boe.opcode(), lhs, rhs);
+    if (!result.has_value()) {
+        fail("{}: Division by zero", boe.source_range());
+        last_visited_ = {};
+        return;
+    }
+    last_visited_ = *result;
 }
 
 void semantic::Intepreter::visit(ast::IdentifierExpression &ie)
 {
-    auto p = curr_frame_->lookup_rvalue(ie.name());
-    if (!p.has_value()) {
-        diags_->error("{}: Undefined variable '{}'", ie.source_range(),
-                      ie.name());
-        curr_frame_->dump(std::cout);
-        last_visited_.reset();
-        return;
-    }
-    last_visited_ = *p;
+    last_visited_ = variable(ie.symbol());
+}
+
+void semantic::Intepreter::visit(ast::ExpressionStatement &es)
+{
+    on_statement(&es);
+    es.expr()->accept(*this);
 }
 
 void semantic::Intepreter::visit(ast::ReturnStatement &rs)
 {
-    last_returned_ = eval(rs.returned_value());
-    leave_frame();
-    throw ReturnSignal{};
+    on_statement(&rs);
+    // Calls in tail position reuse the frame: the arguments are left on
+    // the stack for the call running this function, see call(). The
+    // result of a memoized callee is then cached for the outermost call
+    // only.
+    if (auto *ce = dynamic_cast<ast::CallExpression *>(
+            rs.returned_value().get());
+        ce != nullptr && ce->target() != nullptr) {
+        HLVM_TRACE_EVENT(call, ce->source_range(), ce->arguments().size());
+        for (auto const &arg : ce->arguments()) {
+            stack_.push(eval(arg));
+        }
+        if (failed()) {
+            stack_.pop(ce->arguments().size());
+            return;
+        }
+        tail_callee_ = ce->target();
+        completion_ = Completion::tail_call;
+        return;
+    }
+    // A bare return returns no value, as in the VM
+    auto value = rs.returned_value() ? eval(rs.returned_value()) : Value{};
+    if (failed()) {
+        return;
+    }
+    last_returned_ = value;
+    completion_ = Completion::returned;
+    HLVM_TRACE_EVENT(ret, rs.source_range(),
+                     last_returned_->kind() == Value::Kind::integer
+                         ? last_returned_->as_int()
+                         : 0);
 }
 
 void semantic::Intepreter::visit(ast::IfStatement &is)
 {
-    spdlog::debug("Executing if statement");
-    if (eval(is.condition()) != "0") {
-        spdlog::debug("True hit");
+    on_statement(&is);
+    auto taken = eval(is.condition()).as_int() != 0;
+    if (failed()) {
+        return;
+    }
+    HLVM_TRACE_EVENT(branch, is.source_range(), taken ? 1 : 0);
+    if (taken) {
         if (is.true_branch()) {
             is.true_branch()->accept(*this);
         }
     }
     else {
-        spdlog::debug("False hit");
         if (is.false_branch()) {
             is.false_branch()->accept(*this);
         }
@@ -295,10 +334,18 @@ void semantic::Intepreter::visit(ast::IfStatement &is)
 
 void semantic::Intepreter::visit(ast::WhileStatement &ws)
 {
-    spdlog::debug("Executing while statement");
-    while (eval(ws.condition()) != "0") {
-        spdlog::debug("While loop iteration");
+    HLVM_TRACE_EVENT(statement, ws.source_range(), 0);
+    on_statement(&ws);
+    [[maybe_unused]] std::int64_t iterations{};
+    while (eval(ws.condition()).as_int() != 0 && !failed()) {
+        HLVM_TRACE_EVENT(loop_iteration, ws.source_range(), ++iterations);
+        if (profiler_ != nullptr) {
+            profiler_->count_iteration(&ws);
+        }
         ws.body()->accept(*this);
+        if (completion_ != Completion::normal) {
+            break;
+        }
     }
 }
 
@@ -307,16 +354,87 @@ semantic::Intepreter::Intepreter(Context *ctx, Diagnostics *diags)
 {
 }
 
-void semantic::Intepreter::enter_subframe()
+void semantic::Intepreter::enter_subframe(std::size_t frame_size)
 {
-    // return;
-    auto neo = std::make_unique<Frame>(std::move(curr_frame_));
-    curr_frame_ = std::move(neo);
+    stack_.enter(frame_size, 0);
+}
+
+void semantic::Intepreter::release_frame_arrays(
+    ast::FunctionDeclaration const *fd)
+{
+    for (auto slot : fd->frame_arrays()) {
+        arrays_.release(stack_[slot]);
+    }
 }
 
 void semantic::Intepreter::leave_frame()
 {
-    // return;
-    auto parent = std::move(curr_frame_->parent());
-    curr_frame_ = std::move(parent);
+    stack_.leave();
+}
+
+semantic::Value *semantic::Intepreter::lvalue(ast::Expression *expr)
+{
+    if (auto *ie = dynamic_cast<ast::IdentifierExpression *>(expr)) {
+        return &variable(ie->symbol());
+    }
+    if (auto *ie = dynamic_cast<ast::IndexExpression *>(expr)) {
+        // Rows aren't assignable, see SemanticAnalyzer
+        auto e = element(ie);
+        return e.has_value() && e->dimension->rows == nullptr
+                   ? e->array->data + e->offset
+                   : nullptr;
+    }
+    return nullptr;
+}
+
+std::optional<semantic::Intepreter::Element>
+semantic::Intepreter::element(ast::IndexExpression *ie)
+{
+    // a[i][j] is (a[i])[j]: a row-major offset i * length + j in the
+    // dimension below that of a[i]
+    std::optional<Element> e;
+    if (auto *base = dynamic_cast<ast::IndexExpression *>(ie->base().get())) {
+        e = element(base);
+        if (!e.has_value()) {
+            return std::nullopt;
+        }
+        e->dimension = e->dimension->rows;
+    }
+    else {
+        auto *array = eval(ie->base()).as_array();
+        e = Element{.array = array, .dimension = array, .offset = 0};
+    }
+    auto index = eval(ie->index()).as_int();
+    if (failed()) {
+        return std::nullopt;
+    }
+    if (e->dimension == nullptr || index < 0 ||
+        std::cmp_greater_equal(index, e->dimension->length)) {
+        fail("{}: Index {} out of bounds", ie->source_range(), index);
+        return std::nullopt;
+    }
+    e->offset = e->offset * e->dimension->length + index;
+    return e;
+}
+
+semantic::Value &semantic::Intepreter::variable(Symbol const *symbol)
+{
+    switch (symbol->storage) {
+    case StorageKind::global:
+        return globals_[symbol->slot];
+    case StorageKind::local:
+        return stack_[symbol->slot];
+    case StorageKind::none:
+        break;
+    }
+    throw std::logic_error(
+        std::format("'{}' has no storage", symbol->name));
+}
+
+semantic::Value semantic::Intepreter::make_value(Type *type)
+{
+    if (type == nullptr || type->typekind != TypeKind::array_type) {
+        return {};
+    }
+    return Value{arrays_.make(static_cast<ArrayType *>(type)->dimensions())};
 }
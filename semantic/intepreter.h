@@ -1,13 +1,23 @@
 #pragma once
 #include <ast/recursive-node-visitor.h>
+#include <semantic/call-stack.h>
+#include <diagnostics.h>
+#include <format>
 #include <optional>
-#include <semantic/frame.h>
+#include <semantic/completion.h>
 #include <semantic/semantic-analyzer.h>
+#include <semantic/value.h>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace semantic {
 
+class Memoizer;
+class Profiler;
+class SamplingProfiler;
+
 class Intepreter : public ast::RecursiveNodeVisitor {
   public:
     Intepreter(Context *ctx, Diagnostics *diags);
@@ -20,12 +30,13 @@ class Intepreter : public ast::RecursiveNodeVisitor {
 
     void visit(ast::CompoundStatement &cs) override;
     void visit(ast::DeclarationStatement &ds) override;
-    void visit(ast::ReturnStatement &rs) override; // Temporary solution for
-    // jump out from function in advance: using exception
+    void visit(ast::ExpressionStatement &es) override;
+    void visit(ast::ReturnStatement &rs) override;
     void visit(ast::IfStatement &is) override;
     void visit(ast::WhileStatement &ws) override;
 
     void visit(ast::CallExpression &ce) override;
+    void visit(ast::IndexExpression &ie) override;
     void visit(ast::UnaryExpression &uoe) override;
     void visit(ast::BinaryExpression &boe) override;
     void visit(ast::IdentifierExpression &ie) override;
@@ -34,29 +45,118 @@ class Intepreter : public ast::RecursiveNodeVisitor {
     void visit(ast::StringLiteralExpr &se) override;
 
     /// Should be private, but put here for test
-    void enter_subframe();
+    void enter_subframe(std::size_t frame_size);
 
     void leave_frame();
 
+    /// @brief Profiles the following runs into `profiler`, unless nullptr.
+    void set_profiler(Profiler *profiler)
+    {
+        profiler_ = profiler;
+    }
+
+    /// @brief Keeps `sampler` informed of where the following runs are,
+    /// unless nullptr. Sampling itself is started by the caller.
+    void set_sampler(SamplingProfiler *sampler)
+    {
+        sampler_ = sampler;
+    }
+
+    /// @brief Serves the calls of the functions `memoizer` memoizes from its
+    /// caches in the following runs, unless nullptr.
+    void set_memoizer(Memoizer *memoizer)
+    {
+        memoizer_ = memoizer;
+    }
+
+    /// @brief The value most recently returned by a function, e.g. by 'main'
+    /// once the program has run.
+    [[nodiscard]] std::optional<Value> const &last_returned() const
+    {
+        return last_returned_;
+    }
+
   private:
-    std::string eval(ast::ExpressionPtr const &expr)
+    Value eval(ast::ExpressionPtr const &expr)
     {
         expr->accept(*this);
-        return last_visited_.value();
+        return last_visited_;
     }
 
-    std::string eval(ast::Expression *expr)
+    Value eval(ast::Expression *expr)
     {
         expr->accept(*this);
-        spdlog::debug("Evaluated result: {}", last_visited_.value());
-        return last_visited_.value();
+        return last_visited_;
+    }
+
+    /// @brief Runs `decl` in a frame whose first slots are the `arg_count`
+    /// values pushed last, then the callees of its tail calls in the same
+    /// frame.
+    void call(ast::FunctionDeclaration *decl, std::size_t arg_count);
+
+    /// @brief As call(), but first looks the arguments up in the memoizer,
+    /// and caches the result of a miss.
+    void call_memoized(ast::FunctionDeclaration *decl, std::size_t arg_count);
+
+    /// @brief Frees the arrays dying with the frame of `fd`, the current one.
+    void release_frame_arrays(ast::FunctionDeclaration const *fd);
+
+    /// @brief Returns the storage `expr` designates, or nullptr if it isn't
+    /// an lvalue.
+    Value *lvalue(ast::Expression *expr);
+
+    /// @brief Where an index expression lands: element `offset` of all
+    /// those of the dimension of `array` that `dimension` is a row of.
+    struct Element {
+        Array *array;
+        Array const *dimension; // The first row of the dimension
+        std::size_t offset;
+    };
+
+    /// @brief Evaluates the array and indices of `ie`, outermost first, and
+    /// returns the element, or nullopt once the run failed, e.g. as an index
+    /// is out of bounds.
+    std::optional<Element> element(ast::IndexExpression *ie);
+
+    /// @brief Returns the storage of the variable `symbol` is bound to.
+    Value &variable(Symbol const *symbol);
+
+    /// @brief Profiling hooks, each doing nothing unless a profiler is set.
+    void on_statement(ast::Statement const *s);
+    void on_enter(ast::FunctionDeclaration const *fd);
+    void on_leave();
+
+    /// @brief Makes the initial value of a variable of `type`.
+    Value make_value(Type *type);
+
+    /// @brief Reports an error and ends the run, unwinding with
+    /// Completion::failed.
+    template <typename... Ts>
+    void fail(std::format_string<Ts...> fmt, Ts &&...ts)
+    {
+        diags_->error(fmt, std::forward<Ts>(ts)...);
+        completion_ = Completion::failed;
+    }
+
+    [[nodiscard]] bool failed() const
+    {
+        return completion_ == Completion::failed;
     }
 
     Context *ctx_;
     Diagnostics *diags_;
-    std::unique_ptr<Frame> curr_frame_;
-    std::optional<std::string> last_visited_;
-    std::optional<std::string> last_returned_;
+    CallStack stack_;
+    std::vector<Value> globals_; // Indexed by slot
+    Value last_visited_;
+    Completion completion_{}; // Of the statement executed last
+    ast::FunctionDeclaration *tail_callee_{}; // If completion_ is tail_call
+    Memoizer *memoizer_{};
+    Profiler *profiler_{};
+    SamplingProfiler *sampler_{};
+    std::optional<Value> last_returned_;
+
+    StringPool strings_;
+    ArrayPool arrays_;
 };
 
 } // namespace semantic
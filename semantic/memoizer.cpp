@@ -0,0 +1,115 @@
+#include <semantic/memoizer.h>
+
+#include <algorithm>
+#include <ast/parallel-function-visitor.h>
+#include <print>
+#include <semantic/purity.h>
+#include <semantic/symbol.h>
+#include <semantic/type.h>
+
+namespace {
+
+bool is_array(semantic::Type const *type)
+{
+    return type != nullptr && type->typekind == semantic::TypeKind::array_type;
+}
+
+/// Whether `fd` neither takes nor returns an array.
+bool has_scalar_signature(ast::FunctionDeclaration const *fd)
+{
+    auto *symbol = fd->symbol();
+    if (symbol == nullptr ||
+        symbol->type_ptr->typekind != semantic::TypeKind::function_type) {
+        return false;
+    }
+    auto const *ft = static_cast<semantic::FunctionType *>(symbol->type_ptr);
+    return !is_array(ft->return_type) &&
+           std::ranges::none_of(ft->parameter_types, is_array);
+}
+
+} // namespace
+
+semantic::Memoizer::Memoizer(ast::Program &prog, std::size_t capacity)
+    : capacity_(std::max<std::size_t>(capacity, 1))
+{
+    PurityAnalysis purity(prog);
+    for (auto *fd : ast::function_declarations(prog)) {
+        if (purity.is_pure(fd) && has_scalar_signature(fd)) {
+            caches_[fd];
+        }
+    }
+}
+
+std::size_t
+semantic::Memoizer::KeyHash::operator()(std::span<Value const> key) const
+{
+    std::size_t h = key.size();
+    for (auto const &v : key) {
+        auto bits = v.bits() ^ static_cast<std::uint64_t>(v.kind()) << 56;
+        h ^= std::hash<std::uint64_t>{}(bits) + 0x9e3779b97f4a7c15 + (h << 6) +
+             (h >> 2);
+    }
+    return h;
+}
+
+bool semantic::Memoizer::KeyEqual::operator()(
+    std::span<Value const> lhs, std::span<Value const> rhs) const
+{
+    return std::ranges::equal(lhs, rhs, [](Value a, Value b) {
+        return a.kind() == b.kind() && a.bits() == b.bits();
+    });
+}
+
+std::optional<semantic::Value>
+semantic::Memoizer::lookup(ast::FunctionDeclaration const *fd,
+                           std::span<Value const> args)
+{
+    auto &cache = caches_.at(fd);
+    auto it = cache.index.find(args);
+    if (it == cache.index.end()) {
+        ++cache.stats.misses;
+        return std::nullopt;
+    }
+    ++cache.stats.hits;
+    cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+    return it->second->result;
+}
+
+void semantic::Memoizer::insert(ast::FunctionDeclaration const *fd,
+                                std::span<Value const> args, Value result)
+{
+    auto &cache = caches_.at(fd);
+    if (auto it = cache.index.find(args); it != cache.index.end()) {
+        it->second->result = result; // Cached by a recursive call meanwhile
+        return;
+    }
+    if (cache.entries.size() == capacity_) {
+        cache.index.erase(cache.entries.back().args);
+        cache.entries.pop_back();
+        ++cache.stats.evictions;
+    }
+    cache.entries.push_front(
+        {.args{args.begin(), args.end()}, .result = result});
+    cache.index.emplace(cache.entries.front().args, cache.entries.begin());
+}
+
+void semantic::Memoizer::report(std::ostream &os) const
+{
+    std::vector<std::pair<ast::FunctionDeclaration const *, Stats>> functions;
+    for (auto const &[fd, cache] : caches_) {
+        if (cache.stats.hits + cache.stats.misses != 0) {
+            functions.emplace_back(fd, cache.stats);
+        }
+    }
+    std::ranges::sort(functions, [](auto const &lhs, auto const &rhs) {
+        return lhs.second.hits > rhs.second.hits;
+    });
+
+    std::println(os, "{:>10} {:>10} {:>10}  memoized function", "hits",
+                 "misses", "evictions");
+    for (auto const &[fd, stats] : functions) {
+        std::println(os, "{:>10} {:>10} {:>10}  {} ({})", stats.hits,
+                     stats.misses, stats.evictions, fd->name(),
+                     fd->source_range());
+    }
+}
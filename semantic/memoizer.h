@@ -0,0 +1,91 @@
+#pragma once
+#include <ast/ast.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <ostream>
+#include <semantic/value.h>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace semantic {
+
+/// @brief Caches the results of the pure functions of a program by their
+/// arguments, so that the Intepreter runs each call with the same arguments
+/// once, e.g. turning the naive recursive Fibonacci linear.
+///
+/// Functions are chosen by PurityAnalysis, among those whose parameters and
+/// result aren't arrays: an array is shared, so neither its identity nor its
+/// current elements make a valid key or result. Each function has its own
+/// cache of at most `capacity` results, evicting the least recently used.
+class Memoizer {
+  public:
+    static constexpr std::size_t default_capacity = 1 << 16;
+
+    struct Stats {
+        std::uint64_t hits{};
+        std::uint64_t misses{};
+        std::uint64_t evictions{};
+    };
+
+    explicit Memoizer(ast::Program &prog,
+                      std::size_t capacity = default_capacity);
+
+    [[nodiscard]] bool memoizes(ast::FunctionDeclaration const *fd) const
+    {
+        return caches_.contains(fd);
+    }
+
+    /// @brief The result of calling `fd` with `args`, if cached. Counts a
+    /// hit or a miss.
+    std::optional<Value> lookup(ast::FunctionDeclaration const *fd,
+                                std::span<Value const> args);
+
+    /// @brief Caches `result` as that of calling `fd` with `args`.
+    void insert(ast::FunctionDeclaration const *fd,
+                std::span<Value const> args, Value result);
+
+    [[nodiscard]] Stats const &stats(ast::FunctionDeclaration const *fd) const
+    {
+        return caches_.at(fd).stats;
+    }
+
+    /// @brief Writes the hits, misses and evictions of the memoized
+    /// functions called, by hits.
+    void report(std::ostream &os) const;
+
+  private:
+    using Key = std::vector<Value>;
+
+    // Hashes and compares argument tuples by kind and bits, also as spans,
+    // so that looking up doesn't copy the arguments.
+    struct KeyHash {
+        using is_transparent = void;
+        std::size_t operator()(std::span<Value const> key) const;
+    };
+
+    struct KeyEqual {
+        using is_transparent = void;
+        bool operator()(std::span<Value const> lhs,
+                        std::span<Value const> rhs) const;
+    };
+
+    struct Entry {
+        Key args;
+        Value result;
+    };
+
+    struct Cache {
+        std::list<Entry> entries; // Most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash, KeyEqual>
+            index;
+        Stats stats;
+    };
+
+    std::size_t capacity_;
+    std::unordered_map<ast::FunctionDeclaration const *, Cache> caches_;
+};
+
+} // namespace semantic
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <semantic/symbol.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace semantic {
+
+/// @brief LeBlanc-Cook style name table.
+///
+/// Every name maps to a stack of bindings, the innermost one on top, so a
+/// lookup is a single hash probe no matter how deeply scopes are nested.
+/// Leaving a scope pops exactly the bindings it introduced, which are
+/// remembered in an undo log.
+class NameTable {
+  public:
+    void enter_scope()
+    {
+        scope_marks_.push_back(undo_log_.size());
+    }
+
+    void leave_scope()
+    {
+        auto mark = scope_marks_.back();
+        scope_marks_.pop_back();
+        while (undo_log_.size() != mark) {
+            undo_log_.back()->pop_back();
+            undo_log_.pop_back();
+        }
+    }
+
+    /// @brief Binds `name` in the innermost scope. Fails if the innermost
+    /// scope already binds it.
+    bool define(std::string const &name, Symbol *symbol)
+    {
+        auto &stack = bindings_[name];
+        if (!stack.empty() && stack.back().depth == depth()) {
+            return false;
+        }
+        stack.push_back({.depth = depth(), .symbol = symbol});
+        // Node-based map, so the address of `stack` is stable.
+        undo_log_.push_back(&stack);
+        return true;
+    }
+
+    [[nodiscard]] Symbol *lookup(std::string const &name) const
+    {
+        if (auto it = bindings_.find(name);
+            it != bindings_.end() && !it->second.empty()) {
+            return it->second.back().symbol;
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] Symbol *lookup_local(std::string const &name) const
+    {
+        if (auto it = bindings_.find(name);
+            it != bindings_.end() && !it->second.empty() &&
+            it->second.back().depth == depth()) {
+            return it->second.back().symbol;
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] std::size_t depth() const
+    {
+        return scope_marks_.size();
+    }
+
+  private:
+    struct Binding {
+        std::size_t depth;
+        Symbol *symbol;
+    };
+
+    std::unordered_map<std::string, std::vector<Binding>> bindings_;
+    std::vector<std::vector<Binding> *> undo_log_;
+    std::vector<std::size_t> scope_marks_;
+};
+
+} // namespace semantic
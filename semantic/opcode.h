@@ -0,0 +1,101 @@
+#pragma once
+#include <string_view>
+
+namespace semantic {
+
+/// @brief An operation resolved for the operand types at hand.
+///
+/// The SemanticAnalyzer annotates each operator expression with one, so that
+/// execution engines dispatch on it once instead of inspecting operand types
+/// at run time.
+enum class OpCode : unsigned char {
+    none, // Not analyzed, or invalid
+
+    int_add,
+    int_sub,
+    int_mul,
+    int_div,
+    int_mod,
+    int_eq,
+    int_lt,
+    int_le,
+    int_gt,
+    int_ge,
+    int_neg,
+
+    float_add,
+    float_sub,
+    float_mul,
+    float_div,
+    float_eq,
+    float_lt,
+    float_le,
+    float_gt,
+    float_ge,
+    float_neg,
+
+    identity, // Unary plus
+    assign,
+
+    // Offsets the base by index * stride, the size of the element type
+    array_index,
+};
+
+constexpr std::string_view to_string(OpCode op)
+{
+    switch (op) {
+    case OpCode::none:
+        return "none";
+    case OpCode::int_add:
+        return "int_add";
+    case OpCode::int_sub:
+        return "int_sub";
+    case OpCode::int_mul:
+        return "int_mul";
+    case OpCode::int_div:
+        return "int_div";
+    case OpCode::int_mod:
+        return "int_mod";
+    case OpCode::int_eq:
+        return "int_eq";
+    case OpCode::int_lt:
+        return "int_lt";
+    case OpCode::int_le:
+        return "int_le";
+    case OpCode::int_gt:
+        return "int_gt";
+    case OpCode::int_ge:
+        return "int_ge";
+    case OpCode::int_neg:
+        return "int_neg";
+    case OpCode::float_add:
+        return "float_add";
+    case OpCode::float_sub:
+        return "float_sub";
+    case OpCode::float_mul:
+        return "float_mul";
+    case OpCode::float_div:
+        return "float_div";
+    case OpCode::float_eq:
+        return "float_eq";
+    case OpCode::float_lt:
+        return "float_lt";
+    case OpCode::float_le:
+        return "float_le";
+    case OpCode::float_gt:
+        return "float_gt";
+    case OpCode::float_ge:
+        return "float_ge";
+    case OpCode::float_neg:
+        return "float_neg";
+    case OpCode::identity:
+        return "identity";
+    case OpCode::assign:
+        return "assign";
+    case OpCode::array_index:
+        return "array_index";
+    }
+    return "unknown";
+}
+
+} // namespace semantic
@@ -0,0 +1,103 @@
+#include <semantic/operators.h>
+
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+/// Applies `op` to operands of type T. Comparisons yield 1 or 0.
+template <typename T, typename Op>
+semantic::Value apply(Op op, semantic::Value lhs, semantic::Value rhs)
+{
+    auto result = [&] {
+        if constexpr (std::is_same_v<T, double>) {
+            return op(lhs.as_float(), rhs.as_float());
+        }
+        else {
+            return op(lhs.as_int(), rhs.as_int());
+        }
+    }();
+    if constexpr (std::is_same_v<decltype(result), bool>) {
+        return semantic::Value{std::int64_t{result ? 1 : 0}};
+    }
+    else {
+        return semantic::Value{result};
+    }
+}
+
+} // namespace
+
+semantic::Value semantic::apply_unary(OpCode op, Value value)
+{
+    switch (op) {
+    case OpCode::int_neg:
+        return Value{wrapping_neg(value.as_int())};
+    case OpCode::float_neg:
+        return Value{-value.as_float()};
+    case OpCode::identity:
+        return value;
+    default:
+        throw std::logic_error(
+            std::format("Invalid unary opcode {}", to_string(op)));
+    }
+}
+
+std::optional<semantic::Value>
+semantic::apply_binary(OpCode op, Value lhs, Value rhs)
+{
+    using enum OpCode;
+
+    if ((op == int_div || op == int_mod) && rhs.as_int() == 0) {
+        return std::nullopt;
+    }
+
+    auto ints = [&](auto f) { return apply<long long>(f, lhs, rhs); };
+    auto floats = [&](auto f) { return apply<double>(f, lhs, rhs); };
+
+    switch (op) {
+    case int_add:
+        return ints(wrapping_add);
+    case int_sub:
+        return ints(wrapping_sub);
+    case int_mul:
+        return ints(wrapping_mul);
+    case int_div:
+        return ints(wrapping_div);
+    case int_mod:
+        return ints(wrapping_mod);
+    case int_eq:
+        return ints(std::equal_to{});
+    case int_lt:
+        return ints(std::less{});
+    case int_le:
+        return ints(std::less_equal{});
+    case int_gt:
+        return ints(std::greater{});
+    case int_ge:
+        return ints(std::greater_equal{});
+    case float_add:
+        return floats(std::plus{});
+    case float_sub:
+        return floats(std::minus{});
+    case float_mul:
+        return floats(std::multiplies{});
+    case float_div:
+        return floats(std::divides{});
+    case float_eq:
+        return floats(std::equal_to{});
+    case float_lt:
+        return floats(std::less{});
+    case float_le:
+        return floats(std::less_equal{});
+    case float_gt:
+        return floats(std::greater{});
+    case float_ge:
+        return floats(std::greater_equal{});
+    default:
+        throw std::logic_error(
+            std::format("Invalid binary opcode {}", to_string(op)));
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <semantic/opcode.h>
+#include <semantic/value.h>
+
+namespace semantic {
+
+/// @brief Applies the unary operator `op` to `value`. Throws
+/// std::logic_error if `op` isn't a unary operator.
+Value apply_unary(OpCode op, Value value);
+
+/// @brief Applies the binary operator `op`, but assignment, to the operands.
+/// Comparisons yield integer 1 or 0, and integers divide as wrapping_div()
+/// does. Returns nullopt for an integer division by zero, for the caller to
+/// report. Throws std::logic_error if `op` isn't a binary operator.
+std::optional<Value> apply_binary(OpCode op, Value lhs, Value rhs);
+
+/// @brief Integer arithmetic of all engines: results wrap around in two's
+/// complement, as the JIT's instructions do, where signed overflow would be
+/// undefined.
+inline std::int64_t wrapping_add(std::int64_t lhs, std::int64_t rhs)
+{
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(lhs) +
+                                     static_cast<std::uint64_t>(rhs));
+}
+
+inline std::int64_t wrapping_sub(std::int64_t lhs, std::int64_t rhs)
+{
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(lhs) -
+                                     static_cast<std::uint64_t>(rhs));
+}
+
+inline std::int64_t wrapping_mul(std::int64_t lhs, std::int64_t rhs)
+{
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(lhs) *
+                                     static_cast<std::uint64_t>(rhs));
+}
+
+inline std::int64_t wrapping_neg(std::int64_t value)
+{
+    return wrapping_sub(0, value);
+}
+
+/// @brief `lhs / rhs` for a nonzero `rhs`. INT64_MIN / -1 wraps to INT64_MIN
+/// instead of trapping, as the JIT's idiv path does.
+inline std::int64_t wrapping_div(std::int64_t lhs, std::int64_t rhs)
+{
+    return rhs == -1 ? wrapping_neg(lhs) : lhs / rhs;
+}
+
+/// @brief `lhs % rhs` for a nonzero `rhs`, 0 for INT64_MIN % -1, see
+/// wrapping_div().
+inline std::int64_t wrapping_mod(std::int64_t lhs, std::int64_t rhs)
+{
+    return rhs == -1 ? 0 : lhs % rhs;
+}
+
+} // namespace semantic
@@ -0,0 +1,158 @@
+#include <semantic/profiler.h>
+
+#include <algorithm>
+#include <print>
+#include <string>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+double milliseconds(semantic::Profiler::Clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+/// Entries of `counts` by descending count.
+template <typename Key>
+std::vector<std::pair<Key, std::uint64_t>>
+by_count(std::unordered_map<Key, std::uint64_t> const &counts)
+{
+    std::vector<std::pair<Key, std::uint64_t>> result(counts.begin(),
+                                                      counts.end());
+    std::ranges::sort(result, [](auto const &lhs, auto const &rhs) {
+        return lhs.second > rhs.second;
+    });
+    return result;
+}
+
+} // namespace
+
+semantic::Profiler::Ticks semantic::Profiler::now()
+{
+#if defined(__x86_64__)
+    return static_cast<Ticks>(__rdtsc());
+#else
+    return Clock::now().time_since_epoch().count();
+#endif
+}
+
+semantic::Profiler::Clock::duration
+semantic::Profiler::to_duration(Ticks ticks) const
+{
+    auto elapsed_ticks = now() - start_ticks_;
+    auto elapsed = Clock::now() - start_time_;
+    if (elapsed_ticks <= 0) {
+        return {};
+    }
+    return Clock::duration{static_cast<Clock::rep>(
+        static_cast<double>(ticks) * static_cast<double>(elapsed.count()) /
+        static_cast<double>(elapsed_ticks))};
+}
+
+semantic::Profiler::FunctionStats
+semantic::Profiler::function_stats(ast::FunctionDeclaration const *fd) const
+{
+    auto const &f = functions_.at(fd);
+    return {.calls = f.calls,
+            .inclusive = to_duration(f.inclusive),
+            .exclusive = to_duration(f.exclusive)};
+}
+
+void semantic::Profiler::enter(ast::FunctionDeclaration const *fd)
+{
+    auto parent = activations_.empty() ? 0 : activations_.back().path;
+    auto const &siblings = paths_[parent].children;
+    auto it = std::ranges::find_if(
+        siblings, [&](std::uint32_t i) { return paths_[i].fd == fd; });
+    std::uint32_t path{};
+    if (it != siblings.end()) {
+        path = *it;
+    }
+    else {
+        path = paths_.size();
+        paths_.push_back(
+            {.parent = parent, .fd = fd, .function = &functions_[fd]});
+        paths_[parent].children.push_back(path);
+    }
+
+    auto *f = paths_[path].function;
+    ++f->calls;
+    ++f->active;
+    activations_.push_back({.path = path, .start = now()});
+}
+
+void semantic::Profiler::leave()
+{
+    auto a = activations_.back();
+    activations_.pop_back();
+    auto elapsed = now() - a.start;
+    auto exclusive = elapsed - a.children;
+
+    auto &path = paths_[a.path];
+    path.exclusive += exclusive;
+    path.function->exclusive += exclusive;
+    if (--path.function->active == 0) {
+        path.function->inclusive += elapsed;
+    }
+    if (!activations_.empty()) {
+        activations_.back().children += elapsed;
+    }
+}
+
+void semantic::Profiler::report(std::ostream &os) const
+{
+    std::vector<std::pair<ast::FunctionDeclaration const *, FunctionStats>>
+        functions;
+    for (auto const &[fd, f] : functions_) {
+        functions.emplace_back(fd, function_stats(fd));
+    }
+    std::ranges::sort(functions, [](auto const &lhs, auto const &rhs) {
+        return lhs.second.exclusive > rhs.second.exclusive;
+    });
+
+    std::println(os, "{:>10} {:>14} {:>14}  function", "calls",
+                 "inclusive ms", "exclusive ms");
+    for (auto const &[fd, stats] : functions) {
+        std::println(os, "{:>10} {:>14.3f} {:>14.3f}  {} ({})", stats.calls,
+                     milliseconds(stats.inclusive),
+                     milliseconds(stats.exclusive), fd->name(),
+                     fd->source_range());
+    }
+
+    std::println(os, "\n{:>10}  statement", "count");
+    for (auto const &[s, count] : by_count(statements_)) {
+        std::println(os, "{:>10}  {}", count, s->source_range());
+    }
+
+    std::println(os, "\n{:>10}  loop", "iterations");
+    for (auto const &[ws, count] : by_count(iterations_)) {
+        std::println(os, "{:>10}  {}", count, ws->source_range());
+    }
+}
+
+void semantic::Profiler::write_folded(std::ostream &os) const
+{
+    for (std::uint32_t i = 1; i < paths_.size(); ++i) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      to_duration(paths_[i].exclusive))
+                      .count();
+        if (us == 0) {
+            continue;
+        }
+        std::vector<std::string const *> names;
+        for (auto node = i; node != 0; node = paths_[node].parent) {
+            names.push_back(&paths_[node].fd->name());
+        }
+        std::string stack;
+        for (auto it = names.rbegin(); it != names.rend(); ++it) {
+            if (!stack.empty()) {
+                stack += ';';
+            }
+            stack += **it;
+        }
+        std::println(os, "{} {}", stack, us);
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <ast/ast.h>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace semantic {
+
+/// @brief Collects an instrumenting profile of the interpreter: calls and
+/// inclusive and exclusive time per function, execution counts per statement
+/// and iteration counts per loop.
+///
+/// The Intepreter calls the hooks when a profiler is set; otherwise each hook
+/// site costs a null check. Calls are timed in ticks of the time stamp counter
+/// where there is one, which is several times cheaper to read than the steady
+/// clock, and converted to durations when queried.
+class Profiler {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct FunctionStats {
+        std::uint64_t calls{};
+        Clock::duration inclusive{}; // Recursive calls are counted once
+        Clock::duration exclusive{};
+    };
+
+    void enter(ast::FunctionDeclaration const *fd);
+    void leave();
+
+    void count_statement(ast::Statement const *s)
+    {
+        ++statements_[s];
+    }
+
+    void count_iteration(ast::WhileStatement const *ws)
+    {
+        ++iterations_[ws];
+    }
+
+    [[nodiscard]] FunctionStats
+    function_stats(ast::FunctionDeclaration const *fd) const;
+
+    [[nodiscard]] std::uint64_t
+    statement_count(ast::Statement const *s) const
+    {
+        auto it = statements_.find(s);
+        return it != statements_.end() ? it->second : 0;
+    }
+
+    [[nodiscard]] std::uint64_t
+    iteration_count(ast::WhileStatement const *ws) const
+    {
+        auto it = iterations_.find(ws);
+        return it != iterations_.end() ? it->second : 0;
+    }
+
+    /// @brief Writes the functions by exclusive time, then the statements
+    /// and loops by count, each with its source range.
+    void report(std::ostream &os) const;
+
+    /// @brief Writes exclusive time in microseconds per call stack, one
+    /// "main;f;g 123" line each, as flamegraph tools take.
+    void write_folded(std::ostream &os) const;
+
+  private:
+    using Ticks = std::int64_t;
+
+    static Ticks now();
+
+    /// @brief `ticks` as a duration, at the rate the ticks ran since the
+    /// profiler was made.
+    [[nodiscard]] Clock::duration to_duration(Ticks ticks) const;
+
+    struct Function {
+        std::uint64_t calls{};
+        Ticks inclusive{};
+        Ticks exclusive{};
+        std::uint32_t active{}; // Calls in progress
+    };
+
+    // Call stacks form a tree, node 0 being the root. A node is its parent
+    // and the function called last; entering a function only searches the
+    // few children of the current node.
+    struct Path {
+        std::uint32_t parent;
+        ast::FunctionDeclaration const *fd;
+        Function *function; // Of fd
+        Ticks exclusive{};
+        std::vector<std::uint32_t> children;
+    };
+
+    struct Activation {
+        std::uint32_t path; // Index into paths_
+        Ticks start;
+        Ticks children{};
+    };
+
+    Ticks start_ticks_ = now();
+    Clock::time_point start_time_ = Clock::now();
+
+    std::vector<Path> paths_{Path{.parent = 0, .fd{}, .function{}}};
+
+    std::unordered_map<ast::FunctionDeclaration const *, Function> functions_;
+    std::unordered_map<ast::Statement const *, std::uint64_t> statements_;
+    std::unordered_map<ast::WhileStatement const *, std::uint64_t> iterations_;
+    std::vector<Activation> activations_;
+};
+
+} // namespace semantic
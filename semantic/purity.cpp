@@ -0,0 +1,90 @@
+#include <semantic/purity.h>
+
+#include <ast/parallel-function-visitor.h>
+#include <ast/recursive-node-visitor.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/// Records what a function body does that may make it impure.
+class EffectCollector : public ast::RecursiveNodeVisitor {
+  public:
+    explicit EffectCollector(
+        std::unordered_set<semantic::Symbol const *> const *globals)
+        : globals_(globals)
+    {
+    }
+
+    void visit(ast::IdentifierExpression &ie) override
+    {
+        auto *s = ie.symbol();
+        if (s == nullptr) {
+            impure = true;
+            return;
+        }
+        if (s->type_ptr->typekind == semantic::TypeKind::function_type) {
+            return; // Checked as a callee
+        }
+        if (globals_->contains(s)) {
+            impure = true;
+        }
+    }
+
+    void visit(ast::CallExpression &ce) override
+    {
+        if (ce.target() == nullptr) {
+            impure = true; // Builtins have effects
+        }
+        else {
+            callees.push_back(ce.target());
+        }
+        RecursiveNodeVisitor::visit(ce);
+    }
+
+    bool impure{};
+    std::vector<ast::FunctionDeclaration const *> callees;
+
+  private:
+    std::unordered_set<semantic::Symbol const *> const *globals_;
+};
+
+} // namespace
+
+semantic::PurityAnalysis::PurityAnalysis(ast::Program &prog)
+{
+    std::unordered_set<Symbol const *> globals;
+    for (auto const &ds : prog.declaration_statements()) {
+        globals.insert(ds->declaration()->symbol());
+    }
+
+    // Optimistically assumes every function without a direct effect to be
+    // pure, then removes callers of impure functions until nothing changes.
+    std::unordered_map<ast::FunctionDeclaration const *,
+                       std::vector<ast::FunctionDeclaration const *>>
+        callees;
+    for (auto *fd : ast::function_declarations(prog)) {
+        EffectCollector collector(&globals);
+        fd->accept(collector);
+        if (!collector.impure) {
+            pure_.insert(fd);
+            callees.insert({fd, std::move(collector.callees)});
+        }
+    }
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto const &[fd, fd_callees] : callees) {
+            if (!pure_.contains(fd)) {
+                continue;
+            }
+            for (auto const *callee : fd_callees) {
+                if (!pure_.contains(callee)) {
+                    pure_.erase(fd);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <ast/ast.h>
+#include <unordered_set>
+
+namespace semantic {
+
+/// @brief Finds the functions of an analyzed program whose result depends on
+/// their arguments only, and which have no effect besides returning it.
+///
+/// A function is impure if it touches a global variable, calls something
+/// that isn't a known function (e.g. `print`), or calls an impure function.
+/// Recursion alone doesn't make a function impure.
+class PurityAnalysis {
+  public:
+    explicit PurityAnalysis(ast::Program &prog);
+
+    [[nodiscard]] bool is_pure(ast::FunctionDeclaration const *fd) const
+    {
+        return pure_.contains(fd);
+    }
+
+  private:
+    std::unordered_set<ast::FunctionDeclaration const *> pure_;
+};
+
+} // namespace semantic
@@ -0,0 +1,193 @@
+#pragma once
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace semantic {
+
+using Revision = std::uint64_t;
+
+/// @brief Identifies one instance of a query, e.g. "signature of function f".
+struct QueryKey {
+    std::uint32_t kind;
+    std::string subject;
+
+    bool operator==(QueryKey const &) const = default;
+};
+
+struct QueryKeyHash {
+    std::size_t operator()(QueryKey const &k) const noexcept
+    {
+        return std::hash<std::string>{}(k.subject) * 31 + k.kind;
+    }
+};
+
+/// @brief Memoizes query results together with the queries they read.
+///
+/// Inputs are set from outside and bump the revision when they change.
+/// Derived queries are computed by the function registered for their kind;
+/// every `get` made during the computation is recorded as a dependency. When
+/// a memoized result is requested in a later revision, its dependencies are
+/// brought up to date first, and the query is recomputed only if one of them
+/// actually changed. A recomputed result equal to the old one keeps its old
+/// change revision, so queries depending on it needn't be recomputed either.
+class QueryDatabase {
+  public:
+    using Compute = std::function<std::any(QueryKey const &)>;
+    using Equal = std::function<bool(std::any const &, std::any const &)>;
+
+    struct Stats {
+        std::size_t executed{};
+        std::size_t reused{};
+    };
+
+    template <typename T> void define_query(std::uint32_t kind, Compute compute)
+    {
+        queries_[kind] = {.compute = std::move(compute), .equal = equal<T>};
+    }
+
+    /// @brief Sets an input. The revision is bumped only if the value
+    /// changed.
+    template <typename T> void set_input(QueryKey const &key, T value)
+    {
+        auto &m = memos_[key];
+        if (m.value.has_value() && std::any_cast<T const &>(m.value) == value) {
+            return;
+        }
+        m.value = std::move(value);
+        m.is_input = true;
+        m.changed_at = ++revision_;
+        m.verified_at = revision_;
+    }
+
+    template <typename T> T const &get(QueryKey const &key)
+    {
+        if (!active_.empty()) {
+            active_.back().push_back(key);
+        }
+        return std::any_cast<T const &>(refresh(key).value);
+    }
+
+    [[nodiscard]] Revision revision() const
+    {
+        return revision_;
+    }
+
+    [[nodiscard]] Stats const &stats() const
+    {
+        return stats_;
+    }
+
+    void reset_stats()
+    {
+        stats_ = {};
+    }
+
+  private:
+    struct Memo {
+        std::any value;
+        Revision verified_at{};
+        Revision changed_at{};
+        std::vector<QueryKey> dependencies;
+        bool is_input{};
+        bool computing{};
+    };
+
+    struct Query {
+        Compute compute;
+        Equal equal;
+    };
+
+    template <typename T>
+    static bool equal(std::any const &lhs, std::any const &rhs)
+    {
+        return std::any_cast<T const &>(lhs) == std::any_cast<T const &>(rhs);
+    }
+
+    // References into an unordered_map stay valid when it rehashes, so memos
+    // may be held while computations insert new ones.
+    Memo &refresh(QueryKey const &key)
+    {
+        auto &m = memos_[key];
+        if (m.computing) {
+            throw std::runtime_error{
+                "Cyclic query on '" + key.subject + "'"};
+        }
+        if (m.is_input) {
+            if (!m.value.has_value()) {
+                throw std::logic_error{"Input '" + key.subject + "' not set"};
+            }
+            return m;
+        }
+        if (m.value.has_value() && m.verified_at == revision_) {
+            return m;
+        }
+        if (m.value.has_value() && !dependencies_changed(m)) {
+            m.verified_at = revision_;
+            ++stats_.reused;
+            return m;
+        }
+        execute(key, m);
+        return m;
+    }
+
+    bool dependencies_changed(Memo &m)
+    {
+        m.computing = true;
+        bool changed = false;
+        for (auto const &dep : m.dependencies) {
+            if (refresh(dep).changed_at > m.verified_at) {
+                changed = true;
+                break;
+            }
+        }
+        m.computing = false;
+        return changed;
+    }
+
+    void execute(QueryKey const &key, Memo &m)
+    {
+        auto const &query = queries_.at(key.kind);
+
+        // Resets the active state even if the computation throws
+        struct Guard {
+            QueryDatabase *db;
+            Memo *m;
+            ~Guard()
+            {
+                db->active_.pop_back();
+                m->computing = false;
+            }
+        };
+
+        std::any value;
+        {
+            m.computing = true;
+            active_.emplace_back();
+            Guard guard{.db = this, .m = &m};
+            value = query.compute(key);
+            m.dependencies = std::move(active_.back());
+        }
+        ++stats_.executed;
+
+        if (!m.value.has_value() || !query.equal(m.value, value)) {
+            m.value = std::move(value);
+            m.changed_at = revision_;
+        }
+        m.verified_at = revision_;
+    }
+
+    Revision revision_{};
+    std::unordered_map<std::uint32_t, Query> queries_;
+    std::unordered_map<QueryKey, Memo, QueryKeyHash> memos_;
+    // Dependencies recorded by the queries being computed, innermost last
+    std::vector<std::vector<QueryKey>> active_;
+    Stats stats_;
+};
+
+} // namespace semantic
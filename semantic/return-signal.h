@@ -1,4 +0,0 @@
-#pragma once
-#include <exception>
-
-class ReturnSignal : std::exception {};
@@ -0,0 +1,256 @@
+#include <semantic/sampling-profiler.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+
+// Older glibc only spells it through the union
+#if defined(SIGEV_THREAD_ID) && !defined(sigev_notify_thread_id)
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace {
+
+/// The profiler sampling the calling thread, read by the signal handler.
+semantic::SamplingProfiler *&active()
+{
+    thread_local semantic::SamplingProfiler *current{};
+    return current;
+}
+
+[[noreturn]] void throw_errno(char const *what)
+{
+    throw std::system_error{errno, std::generic_category(), what};
+}
+
+double percent(std::uint64_t part, std::uint64_t whole)
+{
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) /
+                                  static_cast<double>(whole);
+}
+
+/// Entries of `counts` by descending count.
+template <typename Key>
+std::vector<std::pair<Key, std::uint64_t>>
+by_count(std::unordered_map<Key, std::uint64_t> const &counts)
+{
+    std::vector<std::pair<Key, std::uint64_t>> result(counts.begin(),
+                                                      counts.end());
+    std::ranges::sort(result, [](auto const &lhs, auto const &rhs) {
+        return lhs.second > rhs.second;
+    });
+    return result;
+}
+
+} // namespace
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free &&
+                  std::atomic<std::size_t>::is_always_lock_free &&
+                  std::atomic<ast::Statement const *>::is_always_lock_free,
+              "The signal handler needs lock-free atomics");
+
+semantic::SamplingProfiler::SamplingProfiler(
+    std::chrono::microseconds interval, std::size_t capacity)
+    : interval_(interval), path_(0), statement_(nullptr),
+      samples_(std::max<std::size_t>(capacity, 1)), written_(0), dropped_(0)
+{
+}
+
+semantic::SamplingProfiler::~SamplingProfiler()
+{
+    stop();
+}
+
+void semantic::SamplingProfiler::start()
+{
+    if (running_) {
+        return;
+    }
+    if (active() != nullptr) {
+        throw std::logic_error{"The thread is already being sampled"};
+    }
+
+    struct sigaction action{};
+    action.sa_handler = &SamplingProfiler::handle;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &previous_) != 0) {
+        throw_errno("sigaction");
+    }
+
+    // Counting the CPU time of this thread, and signaling it alone, where
+    // the platform can.
+    sigevent event{};
+    event.sigev_signo = SIGPROF;
+#ifdef SIGEV_THREAD_ID
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_notify_thread_id = gettid();
+    auto clock = CLOCK_THREAD_CPUTIME_ID;
+#else
+    event.sigev_notify = SIGEV_SIGNAL;
+    auto clock = CLOCK_PROCESS_CPUTIME_ID;
+#endif
+    if (timer_create(clock, &event, &timer_) != 0) {
+        auto error = errno;
+        sigaction(SIGPROF, &previous_, nullptr);
+        errno = error;
+        throw_errno("timer_create");
+    }
+
+    active() = this;
+    running_ = true;
+
+    auto us = std::max<std::int64_t>(interval_.count(), 1);
+    timespec period{.tv_sec = us / 1'000'000,
+                    .tv_nsec = (us % 1'000'000) * 1000};
+    itimerspec spec{.it_interval = period, .it_value = period};
+    if (timer_settime(timer_, 0, &spec, nullptr) != 0) {
+        auto error = errno;
+        stop();
+        errno = error;
+        throw_errno("timer_settime");
+    }
+}
+
+void semantic::SamplingProfiler::stop()
+{
+    if (!running_) {
+        return;
+    }
+    timer_delete(timer_);
+    sigaction(SIGPROF, &previous_, nullptr);
+    active() = nullptr;
+    running_ = false;
+}
+
+void semantic::SamplingProfiler::enter(ast::FunctionDeclaration const *fd)
+{
+    auto parent = path_.load(std::memory_order_relaxed);
+    auto const &siblings = paths_[parent].children;
+    auto it = std::ranges::find_if(
+        siblings, [&](std::uint32_t i) { return paths_[i].fd == fd; });
+    std::uint32_t path{};
+    if (it != siblings.end()) {
+        path = *it;
+    }
+    else {
+        path = paths_.size();
+        paths_.push_back({.parent = parent, .fd = fd, .children{}});
+        paths_[parent].children.push_back(path);
+    }
+    callers_.push_back(statement_.load(std::memory_order_relaxed));
+    path_.store(path, std::memory_order_relaxed);
+}
+
+void semantic::SamplingProfiler::handle(int /*signal*/)
+{
+    auto saved = errno;
+    if (auto *profiler = active()) {
+        profiler->take_sample();
+    }
+    errno = saved;
+}
+
+void semantic::SamplingProfiler::take_sample()
+{
+    auto i = written_.load(std::memory_order_relaxed);
+    if (i == samples_.size()) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    samples_[i] = {.path = path_.load(std::memory_order_relaxed),
+                   .statement = statement_.load(std::memory_order_relaxed)};
+    written_.store(i + 1, std::memory_order_relaxed);
+}
+
+std::vector<ast::FunctionDeclaration const *>
+semantic::SamplingProfiler::call_stack(std::uint32_t path) const
+{
+    std::vector<ast::FunctionDeclaration const *> result;
+    for (; path != 0; path = paths_[path].parent) {
+        result.push_back(paths_[path].fd);
+    }
+    std::ranges::reverse(result);
+    return result;
+}
+
+void semantic::SamplingProfiler::report(std::ostream &os) const
+{
+    auto taken = samples();
+    std::unordered_map<std::uint32_t, std::uint64_t> per_path;
+    std::unordered_map<ast::Statement const *, std::uint64_t> per_statement;
+    for (auto const &sample : taken) {
+        ++per_path[sample.path];
+        if (sample.statement != nullptr) {
+            ++per_statement[sample.statement];
+        }
+    }
+
+    std::unordered_map<ast::FunctionDeclaration const *, std::uint64_t> self;
+    std::unordered_map<ast::FunctionDeclaration const *, std::uint64_t> total;
+    for (auto const &[path, count] : per_path) {
+        if (path == 0) {
+            continue;
+        }
+        self[paths_[path].fd] += count;
+        // Recursive functions are counted once per sample
+        std::unordered_set<ast::FunctionDeclaration const *> seen;
+        for (auto const *fd : call_stack(path)) {
+            if (seen.insert(fd).second) {
+                total[fd] += count;
+            }
+        }
+    }
+
+    std::println(os, "{} samples every {}, {} dropped", taken.size(),
+                 interval_, dropped());
+    std::println(os, "\n{:>10} {:>7} {:>10} {:>7}  function", "self", "%",
+                 "total", "%");
+    auto self_of = [&](ast::FunctionDeclaration const *fd) {
+        auto it = self.find(fd);
+        return it != self.end() ? it->second : 0;
+    };
+    auto functions = by_count(total);
+    std::ranges::stable_sort(functions, [&](auto const &lhs, auto const &rhs) {
+        return self_of(lhs.first) > self_of(rhs.first);
+    });
+    for (auto const &[fd, count] : functions) {
+        std::println(os, "{:>10} {:>6.2f}% {:>10} {:>6.2f}%  {} ({})",
+                     self_of(fd), percent(self_of(fd), taken.size()), count,
+                     percent(count, taken.size()), fd->name(),
+                     fd->source_range());
+    }
+
+    std::println(os, "\n{:>10} {:>7}  statement", "samples", "%");
+    for (auto const &[s, count] : by_count(per_statement)) {
+        std::println(os, "{:>10} {:>6.2f}%  {}", count,
+                     percent(count, taken.size()), s->source_range());
+    }
+}
+
+void semantic::SamplingProfiler::write_folded(std::ostream &os) const
+{
+    std::vector<std::uint64_t> per_path(paths_.size());
+    for (auto const &sample : samples()) {
+        ++per_path[sample.path];
+    }
+    for (std::uint32_t path = 1; path < paths_.size(); ++path) {
+        if (per_path[path] == 0) {
+            continue;
+        }
+        std::string stack;
+        for (auto const *fd : call_stack(path)) {
+            if (!stack.empty()) {
+                stack += ';';
+            }
+            stack += fd->name();
+        }
+        std::println(os, "{} {}", stack, per_path[path]);
+    }
+}
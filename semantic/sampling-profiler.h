@@ -0,0 +1,117 @@
+#pragma once
+#include <ast/ast.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+#include <vector>
+
+namespace semantic {
+
+/// @brief Samples where the interpreter is at a fixed interval of CPU time,
+/// for runs too long to instrument.
+///
+/// The Intepreter keeps the current call path and statement up to date
+/// through the hooks, each a few stores. A POSIX timer delivers SIGPROF to
+/// the thread that called start(), and the handler only appends the current
+/// path and statement to a preallocated buffer; samples beyond its capacity
+/// are counted as dropped.
+class SamplingProfiler {
+  public:
+    static constexpr std::chrono::microseconds default_interval{1000};
+    static constexpr std::size_t default_capacity = 1 << 20;
+
+    struct Sample {
+        std::uint32_t path; // Call path, 0 if outside any function
+        ast::Statement const *statement;
+    };
+
+    explicit SamplingProfiler(
+        std::chrono::microseconds interval = default_interval,
+        std::size_t capacity = default_capacity);
+    SamplingProfiler(SamplingProfiler const &) = delete;
+    SamplingProfiler(SamplingProfiler &&) = delete;
+    SamplingProfiler &operator=(SamplingProfiler const &) = delete;
+    SamplingProfiler &operator=(SamplingProfiler &&) = delete;
+    ~SamplingProfiler();
+
+    /// @brief Starts sampling the calling thread. Throws std::system_error
+    /// if the timer cannot be set up, std::logic_error if a profiler is
+    /// already sampling it.
+    void start();
+
+    /// @brief Stops sampling. Does nothing if not started.
+    void stop();
+
+    void enter(ast::FunctionDeclaration const *fd);
+
+    void leave()
+    {
+        auto caller = callers_.back();
+        callers_.pop_back();
+        path_.store(paths_[path_.load(std::memory_order_relaxed)].parent,
+                    std::memory_order_relaxed);
+        statement_.store(caller, std::memory_order_relaxed);
+    }
+
+    void at(ast::Statement const *s)
+    {
+        statement_.store(s, std::memory_order_relaxed);
+    }
+
+    /// @brief The samples taken, valid once stopped.
+    [[nodiscard]] std::vector<Sample> samples() const
+    {
+        return {samples_.begin(),
+                samples_.begin() + written_.load(std::memory_order_relaxed)};
+    }
+
+    [[nodiscard]] std::uint64_t dropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief The functions of call path `path`, outermost first.
+    [[nodiscard]] std::vector<ast::FunctionDeclaration const *>
+    call_stack(std::uint32_t path) const;
+
+    /// @brief Writes the functions by self samples, with the samples having
+    /// them anywhere on the stack, then the statements by samples.
+    void report(std::ostream &os) const;
+
+    /// @brief Writes the sample count per call stack, one "main;f;g 123"
+    /// line each, as flamegraph tools and pprof take.
+    void write_folded(std::ostream &os) const;
+
+  private:
+    struct Path {
+        std::uint32_t parent;
+        ast::FunctionDeclaration const *fd;
+        std::vector<std::uint32_t> children;
+    };
+
+    static void handle(int signal);
+    void take_sample();
+
+    std::chrono::microseconds interval_;
+
+    // Written by the interpreter, read by the signal handler. Both run on
+    // the same thread, so relaxed lock-free atomics suffice.
+    std::atomic<std::uint32_t> path_;
+    std::atomic<ast::Statement const *> statement_;
+
+    std::vector<Path> paths_{Path{.parent = 0, .fd{}, .children{}}};
+    std::vector<ast::Statement const *> callers_; // Statements to resume
+
+    std::vector<Sample> samples_; // Allocated up front
+    std::atomic<std::size_t> written_;
+    std::atomic<std::uint64_t> dropped_;
+
+    bool running_{};
+    timer_t timer_{};
+    struct sigaction previous_{}; // Handler replaced by ours
+};
+
+} // namespace semantic
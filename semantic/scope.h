@@ -1,10 +1,11 @@
 #pragma once
 #include <helper.h>
-#include <map>
 #include <memory>
 #include <ranges>
+#include <semantic/arena.h>
 #include <semantic/symbol-table.h>
 #include <semantic/symbol.h>
+#include <semantic/type-interner.h>
 #include <semantic/type.h>
 #include <spdlog/spdlog.h>
 #include <string>
@@ -13,21 +14,26 @@
 
 namespace semantic {
 
+/// @brief A lexical scope. Scopes live in their Context's arena.
+///
+/// Most block scopes declare nothing, so the tables of a scope are only made
+/// when the first symbol is added, and children are linked intrusively.
 class Scope {
     friend class Context;
 
   public:
-    Scope(Scope *parent) : parent_(parent)
+    Scope(Scope *parent, TypeInterner *types, Arena *arena)
+        : parent_(parent), types_(types), arena_(arena)
     {
         if (parent_ != nullptr)
             parent_->add_child(this);
     }
 
-    // Since Scope doesn't owns any resources, default copy/move is ok
-    Scope(Scope const &) = default;
-    Scope(Scope &&) noexcept = default;
-    Scope &operator=(Scope const &) = default;
-    Scope &operator=(Scope &&) = default;
+    // Linked into the scope tree by address
+    Scope(Scope const &) = delete;
+    Scope(Scope &&) = delete;
+    Scope &operator=(Scope const &) = delete;
+    Scope &operator=(Scope &&) = delete;
 
     ~Scope() = default;
 
@@ -38,9 +44,32 @@ class Scope {
 
     void add_child(Scope *child)
     {
-        children_.push_back(child);
+        (last_child_ != nullptr ? last_child_->next_sibling_ : first_child_) =
+            child;
+        last_child_ = child;
     }
 
+    /// @brief Unlinks `child`, e.g. before the Context that owns it dies.
+    void remove_child(Scope *child)
+    {
+        Scope *prev{};
+        for (auto *s = first_child_; s != nullptr; s = s->next_sibling_) {
+            if (s != child) {
+                prev = s;
+                continue;
+            }
+            (prev != nullptr ? prev->next_sibling_ : first_child_) =
+                s->next_sibling_;
+            if (last_child_ == s) {
+                last_child_ = prev;
+            }
+            s->next_sibling_ = nullptr;
+            return;
+        }
+    }
+
+    /// @brief Recursive lookup through the enclosing scopes. During analysis
+    /// use Context::lookup_symbol instead, which costs one hash probe.
     Symbol *lookup_symbol(std::string const &name)
     {
         auto *symbol = lookup_local_symbol(name);
@@ -55,86 +84,53 @@ class Scope {
 
     Symbol *lookup_local_symbol(std::string const &name)
     {
-        auto *symbol = symbol_table_.lookup(name);
-        if (symbol != nullptr) {
-            return symbol;
-        }
-        return nullptr;
+        return tables_ != nullptr ? tables_->symbol_table.lookup(name)
+                                  : nullptr;
     }
 
-    void define_symbol(std::string const &name, Symbol symbol)
+    void add_symbol(Symbol *symbol)
     {
-        spdlog::debug("Defining symbol '{}'", symbol.name);
-        symbol_table_.define(name, std::move(symbol));
+        tables().symbol_table.add(symbol);
     }
 
     Type *lookup_type(std::string const &name)
     {
-        if (auto it = named_types_.find(name); it != named_types_.end()) {
+        if (tables_ == nullptr) {
+            return nullptr;
+        }
+        if (auto it = tables_->named_types.find(name);
+            it != tables_->named_types.end()) {
             return it->second.get();
         }
         return nullptr;
     }
 
-    ArrayType *define_array_type(ArrayType array_type)
-    {
-        auto [it, inserted] = array_types_.emplace(
-            array_type, std::make_unique<ArrayType>(array_type));
-
-        auto *p = define_pointer_type(PointerType(array_type.element_type));
-        assert(p && "Pointer type error");
-        it->second->convertible_set_.insert(p);
-
-        return it->second.get();
-    }
-
-    PointerType *define_pointer_type(PointerType pointer_type)
-    {
-        auto [it, inserted] = pointer_types_.emplace(
-            pointer_type, std::make_unique<PointerType>(pointer_type));
-        return it->second.get();
-    }
-
-    FunctionType *define_function_type(FunctionType function_type)
-    {
-        auto [it, inserted] = function_types_.emplace(
-            function_type, std::make_unique<FunctionType>(function_type));
-        return it->second.get();
-    }
+    // Unnamed types are interned program-wide, so they are shared by every
+    // scope.
 
-    ArrayType *get_array_type(ArrayType const &atype)
+    ArrayType *define_array_type(Type *element_type, std::size_t length)
     {
-        auto it = array_types_.find(atype);
-        if (it != array_types_.end()) {
-            return it->second.get();
-        }
-        return nullptr;
+        return types_->array_type(element_type, length);
     }
 
-    PointerType *get_pointer_type(PointerType const &ptype)
+    PointerType *define_pointer_type(Type *pointee_type)
     {
-        auto it = pointer_types_.find(ptype);
-        if (it != pointer_types_.end()) {
-            return it->second.get();
-        }
-        return nullptr;
+        return types_->pointer_type(pointee_type);
     }
 
-    FunctionType *get_function_type(FunctionType const &ftype)
+    FunctionType *define_function_type(Type *return_type,
+                                       std::vector<Type *> const &param_types,
+                                       ast::FunctionDeclaration *decl)
     {
-        auto it = function_types_.find(ftype);
-        if (it != function_types_.end()) {
-            return it->second.get();
-        }
-        return nullptr;
+        return types_->function_type(return_type, param_types, decl);
     }
 
     PointerType *decay_to_pointer_type(Type *type)
     {
         switch (type->typekind) {
         case TypeKind::array_type: {
-            auto *p = get_pointer_type(
-                PointerType(static_cast<ArrayType *>(type)->element_type));
+            auto *p = types_->find_pointer_type(
+                static_cast<ArrayType *>(type)->element_type);
             return p;
         }
         case TypeKind::pointer_type:
@@ -149,30 +145,18 @@ class Scope {
         spdlog::debug("{}Scope at {}:", indent_string(indent),
                       static_cast<void *>(this));
         // All things in the scope
-        symbol_table_.dump(indent + 1);
-
-        spdlog::debug("{}Array Types:", indent_string(indent + 1));
-        for (auto const &[atype, type] : array_types_) {
-            type->dump(indent + 2);
-        }
-
-        spdlog::debug("{}Pointer Types:", indent_string(indent + 1));
-        for (auto const &[ptype, type] : pointer_types_) {
-            type->dump(indent + 2);
-        }
-
-        spdlog::debug("{}Function Types:", indent_string(indent + 1));
-        for (auto const &[ftype, type] : function_types_) {
-            type->dump(indent + 2);
-        }
-
-        for (auto const &[name, type] : named_types_) {
-            spdlog::debug("{}Named Type {}: Size={}, TypeKind={}",
-                          indent_string(indent + 2), name, type->type_size,
-                          to_string(type->typekind));
+        if (tables_ != nullptr) {
+            tables_->symbol_table.dump(indent + 1);
+
+            for (auto const &[name, type] : tables_->named_types) {
+                spdlog::debug("{}Named Type {}: Size={}, TypeKind={}",
+                              indent_string(indent + 2), name, type->type_size,
+                              to_string(type->typekind));
+            }
         }
         spdlog::debug("{}Child Scopes:", indent_string(indent + 1));
-        for (auto const &child : children_) {
+        for (auto *child = first_child_; child != nullptr;
+             child = child->next_sibling_) {
             // child->dump(indent + 1);
             spdlog::debug("{}Child Scope at {:p}", indent_string(indent + 2),
                           static_cast<void *>(child));
@@ -180,20 +164,29 @@ class Scope {
     }
 
   private:
-    Scope *parent_{nullptr};
-    std::vector<Scope *> children_;
+    struct Tables {
+        SymbolTable symbol_table;
 
-    SymbolTable symbol_table_;
+        // User-defined types
+        std::unordered_map<std::string, std::unique_ptr<Type>> named_types;
+    };
 
-    // Functions, lambda
-    // std::vector<std::unique_ptr<Type>> unnamed_types_;
+    Tables &tables()
+    {
+        if (tables_ == nullptr) {
+            tables_ = arena_->make<Tables>();
+        }
+        return *tables_;
+    }
 
-    std::map<ArrayType, std::unique_ptr<ArrayType>> array_types_;
-    std::map<PointerType, std::unique_ptr<PointerType>> pointer_types_;
-    std::map<FunctionType, std::unique_ptr<FunctionType>> function_types_;
+    Scope *parent_{nullptr};
+    Scope *first_child_{};
+    Scope *last_child_{};
+    Scope *next_sibling_{};
 
-    // User-defined types
-    std::unordered_map<std::string, std::unique_ptr<Type>> named_types_;
+    TypeInterner *types_;
+    Arena *arena_;
+    Tables *tables_{};
 };
 
 } // namespace semantic
@@ -2,36 +2,96 @@
 #include <semantic/semantic-analyzer.h>
 
 #include <algorithm>
+#include <ast/parallel-function-visitor.h>
 #include <diagnostics.h>
 #include <ranges>
+#include <stdexcept>
+#include <utility>
 #include <semantic/context.h>
+#include <semantic/escape.h>
 #include <semantic/scope.h>
 
-semantic::SemanticAnalyzer::SemanticAnalyzer(Context *ctx, Diagnostics *diags)
-    : ctx_(ctx), diags_(diags)
+namespace {
+
+/// Picks the integer or float variant of an operation on operands of `type`,
+/// or none if the type has no such operation.
+semantic::OpCode specialize(semantic::Type *type, semantic::OpCode int_op,
+                            semantic::OpCode float_op)
+{
+    using semantic::BuiltinType;
+    if (type->typekind != semantic::TypeKind::builtin_type) {
+        return semantic::OpCode::none;
+    }
+    switch (static_cast<BuiltinType *>(type)->builintypekind) {
+    case BuiltinType::Kind::integer_type:
+        return int_op;
+    case BuiltinType::Kind::float_type:
+        return float_op;
+    default:
+        return semantic::OpCode::none;
+    }
+}
+
+} // namespace
+
+semantic::SemanticAnalyzer::SemanticAnalyzer(Context *ctx, Diagnostics *diags,
+                                             ThreadPool *pool)
+    : ctx_(ctx), diags_(diags), pool_(pool)
 {
-    using enum TypeKind;
-    ctx_->define_builtin_type("int",
-                              BuiltinType(4, BuiltinType::Kind::integer_type));
-    ctx_->define_builtin_type("float",
-                              BuiltinType(4, BuiltinType::Kind::float_type));
-    ctx_->define_builtin_type("string",
-                              BuiltinType(8, BuiltinType::Kind::string_type));
+    if (ctx_->parent() != nullptr) {
+        return; // Builtins are inherited
+    }
+    using enum BuiltinType::Kind;
+    ctx_->define_builtin_type("int", integer_type, 4);
+    ctx_->define_builtin_type("float", float_type, 4);
+    ctx_->define_builtin_type("string", string_type, 8);
 }
 
 void semantic::SemanticAnalyzer::visit(ast::Program &prog)
 {
     ctx_->push_scope();
     prog.global_scope_ = ctx_->current_scope();
+
+    // Pass 1: global symbols. Functions come first so that they can be used
+    // before their declaration.
+    std::vector<ast::FunctionDeclaration *> functions;
+    for (auto *fd : ast::function_declarations(prog)) {
+        if (declare_function(*fd)) {
+            functions.push_back(fd);
+        }
+    }
     for (auto const &decl : prog.decls_) {
-        decl->accept(*this);
+        if (dynamic_cast<ast::VariableDeclaration *>(
+                decl->declaration().get()) != nullptr) {
+            decl->accept(*this);
+        }
+    }
+    prog.global_frame_size_ = next_global_slot_;
+
+    // Pass 2: function bodies, which are independent of each other now
+    if (pool_ != nullptr) {
+        ast::ParallelFunctionVisitor<SemanticAnalyzer> bodies(
+            pool_, [this](Diagnostics *diags) {
+                return std::make_unique<SemanticAnalyzer>(ctx_->make_child(),
+                                                          diags);
+            });
+        bodies.run(functions, diags_);
+    }
+    else {
+        for (auto *fd : functions) {
+            fd->accept(*this);
+        }
     }
+
     ctx_->pop_scope();
+    if (!diags_->has_error()) {
+        EscapeAnalysis{prog};
+    }
 }
 
 void semantic::SemanticAnalyzer::visit(ast::VariableDeclaration &vd)
 {
-    if (ctx_->current_scope()->lookup_local_symbol(vd.name()) != nullptr) {
+    if (ctx_->lookup_local_symbol(vd.name()) != nullptr) {
         diags_->error("Variable re-declaration error: {}", vd.name());
         return;
     }
@@ -65,45 +125,74 @@ void semantic::SemanticAnalyzer::visit(ast::VariableDeclaration &vd)
     }
 
     Type *type = vd.resolved_type_;
-    ctx_->current_scope()->define_symbol(
-        vd.name(), Symbol{.name = vd.name(),
-                          .type_ptr = type,
-                          .symbolkind = SymbolKind::variable});
-    vd.set_symbol(ctx_->current_scope()->lookup_local_symbol(vd.name()));
+    vd.set_symbol(ctx_->define_symbol(
+        Symbol{.name = vd.name(),
+               .type_ptr = type,
+               .symbolkind = SymbolKind::variable}));
+    allocate_slot(vd.symbol());
 }
 
-void semantic::SemanticAnalyzer::visit(ast::FunctionDeclaration &fd)
+void semantic::SemanticAnalyzer::allocate_slot(Symbol *symbol)
 {
-    auto *out = ctx_->current_scope();
-    ctx_->push_scope();
-    auto *in = ctx_->current_scope();
+    if (function_ == nullptr) {
+        symbol->storage = StorageKind::global;
+        symbol->slot = next_global_slot_++;
+        return;
+    }
+    symbol->storage = StorageKind::local;
+    symbol->slot = next_slot_++;
+    frame_size_ = std::max(frame_size_, next_slot_);
+}
 
-    if (out->lookup_local_symbol(fd.name()) != nullptr) {
+bool semantic::SemanticAnalyzer::declare_function(ast::FunctionDeclaration &fd)
+{
+    if (ctx_->lookup_local_symbol(fd.name()) != nullptr) {
         diags_->error("Function re-declaration error: {}", fd.name());
-        return;
+        return false;
     }
 
-    // Constructs a function type instance
+    // Constructs a function type instance. The function symbol is defined
+    // before entering the function scope, so that parameters shadow it.
     std::vector<Type *> param_types;
-    for (auto &[paramtype, name, psymbol] : fd.parameters()) {
-        paramtype->accept(*this);
-        param_types.push_back(resolve_type(paramtype.get()));
-        assert(!name.empty()); // Name won't be empty, as we changed the syntax.
-        in->define_symbol(name, Symbol{.name = name,
-                                       .type_ptr = param_types.back(),
-                                       .symbolkind = SymbolKind::variable});
-        psymbol = in->lookup_local_symbol(name);
-    }
-    fd.return_type()->accept(*this);
-    auto ft =
-        FunctionType(resolve_type(fd.return_type().get()), param_types, &fd);
-
-    auto *ptr = out->define_function_type(ft);
-    out->define_symbol(fd.name(), Symbol{.name = fd.name(),
-                                         .type_ptr = ptr,
-                                         .symbolkind = SymbolKind::variable});
-
-    fd.set_symbol(out->lookup_local_symbol(fd.name()));
+    for (auto const &param : fd.parameters()) {
+        param_types.push_back(resolve_type(param.type.get()));
+    }
+    auto *ptr = ctx_->current_scope()->define_function_type(
+        resolve_type(fd.return_type().get()), param_types, &fd);
+    fd.set_symbol(ctx_->define_symbol(
+        Symbol{.name = fd.name(),
+               .type_ptr = ptr,
+               .symbolkind = SymbolKind::variable}));
+    return true;
+}
+
+void semantic::SemanticAnalyzer::visit(ast::FunctionDeclaration &fd)
+{
+    // Global functions are declared by the first pass already
+    if (fd.symbol() == nullptr && !declare_function(fd)) {
+        return;
+    }
+    auto const &param_types =
+        static_cast<FunctionType *>(fd.symbol()->type_ptr)->parameter_types;
+
+    auto *enclosing = std::exchange(function_, &fd);
+    next_slot_ = frame_size_ = 0;
+
+    ctx_->push_scope();
+    for (auto &&[param, type] : std::views::zip(fd.parameters(), param_types)) {
+        assert(!param.name.empty()); // Name won't be empty, as we changed the
+                                     // syntax.
+        param.symbol = ctx_->define_symbol(
+            Symbol{.name = param.name,
+                   .type_ptr = type,
+                   .symbolkind = SymbolKind::variable});
+        if (param.symbol == nullptr) {
+            diags_->error("{}: Parameter re-declaration error: {}",
+                          fd.source_range(), param.name);
+            continue;
+        }
+        allocate_slot(param.symbol);
+    }
 
     // Bypasses compound statement scope for function parameters
     for (auto const &stmt : fd.body()->statements()) {
@@ -111,6 +200,8 @@ void semantic::SemanticAnalyzer::visit(ast::FunctionDeclaration &fd)
     }
 
     ctx_->pop_scope();
+    fd.set_frame_size(frame_size_);
+    function_ = enclosing;
 }
 
 void semantic::SemanticAnalyzer::visit(ast::IfStatement &is)
@@ -144,11 +235,13 @@ void semantic::SemanticAnalyzer::visit(ast::WhileStatement &ws)
 
 void semantic::SemanticAnalyzer::visit(ast::CompoundStatement &cs)
 {
+    auto mark = next_slot_;
     ctx_->push_scope();
     for (auto const &stmt : cs.statements()) {
         stmt->accept(*this);
     }
     ctx_->pop_scope();
+    next_slot_ = mark;
 }
 
 void semantic::SemanticAnalyzer::visit(ast::DeclarationStatement &ds)
@@ -194,11 +287,22 @@ void semantic::SemanticAnalyzer::visit(ast::IndexExpression &ie)
                       ie.base()->type()->canonical_name());
         return;
     }
-    ie.set_type(pptr);
+    ie.set_type(pptr->pointee_type);
+    ie.set_opcode(OpCode::array_index);
+    ie.set_stride(pptr->pointee_type->type_size);
 }
 
 void semantic::SemanticAnalyzer::visit(ast::CallExpression &ce)
 {
+    auto *name = dynamic_cast<ast::IdentifierExpression *>(ce.callee().get());
+    if (name != nullptr && ctx_->lookup_symbol(name->name()) == nullptr) {
+        if (auto builtin = builtin_named(name->name());
+            builtin != Builtin::none) {
+            analyze_builtin_call(ce, builtin);
+            return;
+        }
+    }
+
     ce.callee()->accept(*this);
     for (auto const &arg : ce.arguments()) {
         arg->accept(*this);
@@ -244,17 +348,54 @@ void semantic::SemanticAnalyzer::visit(ast::CallExpression &ce)
         }
     }
 
+    ce.set_target(ft->decl);
     ce.set_type(ft->return_type);
 }
 
+void semantic::SemanticAnalyzer::analyze_builtin_call(ast::CallExpression &ce,
+                                                      Builtin builtin)
+{
+    for (auto const &arg : ce.arguments()) {
+        arg->accept(*this);
+    }
+    if (diags_->has_error())
+        return;
+
+    switch (builtin) {
+    case Builtin::print:
+        if (ce.arguments().size() != 1) {
+            diags_->error("{}: 'print' takes 1 argument, got {}",
+                          ce.source_range(), ce.arguments().size());
+            return;
+        }
+        if (auto *type = ce.arguments().front()->type();
+            type->typekind != TypeKind::builtin_type) {
+            diags_->error("{}: 'print' cannot print a value of type {}",
+                          ce.source_range(), type->canonical_name());
+            return;
+        }
+        break;
+    case Builtin::none:
+        throw std::logic_error{"Not a builtin"};
+    }
+
+    ce.set_builtin(builtin);
+    ce.set_type(ctx_->get_builtin_type("int"));
+}
+
 void semantic::SemanticAnalyzer::visit(ast::IdentifierExpression &ie)
 {
-    auto *s = ctx_->current_scope()->lookup_symbol(ie.name());
+    auto *s = ctx_->lookup_symbol(ie.name());
     if (s == nullptr) {
         diags_->error("{}: Undefined identifier '{}'", ie.source_range(),
                       ie.name());
         return;
     }
+    if (s->type_ptr == nullptr) {
+        diags_->error("{}: '{}' has an invalid declaration", ie.source_range(),
+                      ie.name());
+        return;
+    }
 
     ie.set_symbol(s);
     ie.set_type(s->type_ptr);
@@ -263,7 +404,20 @@ void semantic::SemanticAnalyzer::visit(ast::IdentifierExpression &ie)
 void semantic::SemanticAnalyzer::visit(ast::UnaryExpression &ue)
 {
     ue.expr()->accept(*this);
-    ue.set_type(ue.expr()->type());
+    if (diags_->has_error())
+        return;
+
+    auto *type = ue.expr()->type();
+    auto opcode = ue.op() == "-"
+                      ? specialize(type, OpCode::int_neg, OpCode::float_neg)
+                      : specialize(type, OpCode::identity, OpCode::identity);
+    if (opcode == OpCode::none) {
+        diags_->error("{}: Invalid operand type for unary '{}': {}",
+                      ue.source_range(), ue.op(), type->canonical_name());
+        return;
+    }
+    ue.set_opcode(opcode);
+    ue.set_type(type);
 }
 
 void semantic::SemanticAnalyzer::visit(ast::BinaryExpression &be)
@@ -283,42 +437,71 @@ void semantic::SemanticAnalyzer::visit(ast::BinaryExpression &be)
         return;
     }
 
+    using enum OpCode;
+    auto *type = be.lhs()->type();
+    auto arithmetic = [&](OpCode int_op, OpCode float_op) {
+        auto opcode = specialize(type, int_op, float_op);
+        if (opcode == none) {
+            diags_->error("{}: Invalid operand types for arithmetic "
+                          "operation: {}",
+                          be.source_range(), type->canonical_name());
+            return;
+        }
+        be.set_opcode(opcode);
+        be.set_type(type);
+    };
+    auto comparison = [&](OpCode int_op, OpCode float_op) {
+        auto opcode = specialize(type, int_op, float_op);
+        if (opcode == none) {
+            diags_->error("{}: Invalid operand types for comparison: {}",
+                          be.source_range(), type->canonical_name());
+            return;
+        }
+        be.set_opcode(opcode);
+        be.set_type(ctx_->get_builtin_type("int")); // Actually boolean
+    };
+
     switch (be.op().kind) {
     case TokenKind::plus:
+        arithmetic(int_add, float_add);
+        break;
     case TokenKind::minus:
+        arithmetic(int_sub, float_sub);
+        break;
     case TokenKind::star:
+        arithmetic(int_mul, float_mul);
+        break;
     case TokenKind::slash:
+        arithmetic(int_div, float_div);
+        break;
     case TokenKind::percent:
-        if (be.lhs()->type() != be.lhs()->type()) {
-            diags_->error("{}: Invalid operand types for arithmetic "
-                          "operation: {}",
-                          be.source_range(),
-                          to_string(be.lhs()->type()->typekind));
-            return;
-        }
-        be.set_type(be.lhs()->type());
+        arithmetic(int_mod, none);
         break;
     case TokenKind::equal:
-        if (be.lhs()->type() != be.rhs()->type()) {
-            diags_->error("{}: Invalid operand types for assignment: {}",
-                          be.source_range(),
-                          to_string(be.lhs()->type()->typekind));
+        // Rows are views into the values of their array, not variables
+        if (type->typekind == TypeKind::array_type &&
+            dynamic_cast<ast::IndexExpression *>(be.lhs().get()) != nullptr) {
+            diags_->error("{}: Cannot assign to a row of an array",
+                          be.source_range());
             return;
         }
-        be.set_type(be.lhs()->type());
+        be.set_opcode(assign);
+        be.set_type(type);
         break;
     case TokenKind::less:
+        comparison(int_lt, float_lt);
+        break;
     case TokenKind::lessthan:
+        comparison(int_le, float_le);
+        break;
     case TokenKind::more:
+        comparison(int_gt, float_gt);
+        break;
     case TokenKind::morethan:
+        comparison(int_ge, float_ge);
+        break;
     case TokenKind::equalequal:
-        if (be.lhs()->type() != be.rhs()->type()) {
-            diags_->error("{}: Invalid operand types for assignment: {}",
-                          be.source_range(),
-                          to_string(be.lhs()->type()->typekind));
-            return;
-        }
-        be.set_type(ctx_->get_builtin_type("int")); // Actually boolean
+        comparison(int_eq, float_eq);
         break;
     default:
         throw std::runtime_error(
@@ -364,8 +547,8 @@ void semantic::SemanticAnalyzer::visit(ast::ArrayType &at)
         return;
     }
 
-    ArrayType array_type(elem_type, at.size());
-    last_resolved_type_ = ctx_->current_scope()->define_array_type(array_type);
+    last_resolved_type_ =
+        ctx_->current_scope()->define_array_type(elem_type, at.size());
 }
 
 void semantic::SemanticAnalyzer::visit(ast::PointerType &pt)
@@ -377,9 +560,8 @@ void semantic::SemanticAnalyzer::visit(ast::PointerType &pt)
         return;
     }
 
-    PointerType pointer_type(pointee_type);
     last_resolved_type_ =
-        ctx_->current_scope()->define_pointer_type(pointer_type);
+        ctx_->current_scope()->define_pointer_type(pointee_type);
 }
 
 semantic::Type *semantic::SemanticAnalyzer::resolve_type(ast::Type *type)
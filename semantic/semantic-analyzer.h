@@ -1,19 +1,25 @@
 #pragma once
 #include <ast/ast.h>
+#include <cstdint>
 #include <unordered_map>
 
 class Diagnostics;
+class ThreadPool;
 
 namespace semantic {
 
-struct Context;
+class Context;
 
 /// brief A symbol collector and name resolver and type checker.
 class SemanticAnalyzer : public ast::RecursiveNodeVisitor {
   public:
-    SemanticAnalyzer(Context *ctx, Diagnostics *diags);
+    /// @param pool If given, function bodies are analyzed in parallel on it.
+    SemanticAnalyzer(Context *ctx, Diagnostics *diags,
+                     ThreadPool *pool = nullptr);
 
-    /// @brief Analyzes a program
+    /// @brief Analyzes a program in two passes. The first one collects the
+    /// signatures of global functions, then global variables; the second one
+    /// checks function bodies, each in a child context of its own.
     void visit(ast::Program &prog) override;
 
     void visit(ast::VariableDeclaration &vd) override;
@@ -37,13 +43,34 @@ class SemanticAnalyzer : public ast::RecursiveNodeVisitor {
     void visit(ast::ArrayType &at) override;
     void visit(ast::PointerType &pt) override;
 
-  private:
+    /// @brief Returns the semantic type denoted by `type`, or nullptr if it is
+    /// invalid.
     Type *resolve_type(ast::Type *type);
+
+  private:
+    /// @brief Defines the symbol of a function in the current scope. Returns
+    /// false on error.
+    bool declare_function(ast::FunctionDeclaration &fd);
+
+    /// @brief Checks a call of `builtin`, and resolves the call to it.
+    void analyze_builtin_call(ast::CallExpression &ce, Builtin builtin);
+
     Type *resolve_type(std::string_view name);
 
+    /// @brief Gives a variable a slot in the frame of the current function,
+    /// or in the global frame outside of functions.
+    void allocate_slot(Symbol *symbol);
+
     Context *ctx_;
     Diagnostics *diags_;
+    ThreadPool *pool_;
     Type *last_resolved_type_{};
+
+    ast::FunctionDeclaration *function_{}; // Being analyzed
+    // Slots of a block are reused after the block
+    std::uint32_t next_slot_{};
+    std::uint32_t frame_size_{};
+    std::uint32_t next_global_slot_{};
 };
 
 } // namespace semantic
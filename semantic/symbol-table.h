@@ -1,43 +1,43 @@
 #pragma once
+#include <algorithm>
 #include <cstddef>
 #include <helper.h>
 #include <print>
 #include <semantic/symbol.h>
 #include <spdlog/spdlog.h>
-#include <unordered_map>
+#include <vector>
 
 namespace semantic {
 
+/// @brief The symbols declared directly in one scope.
+///
+/// Symbols are owned by the Context; name resolution during analysis goes
+/// through the Context's NameTable. This list only serves lookups after
+/// analysis (e.g. finding 'main') and dumping.
 class SymbolTable {
   public:
-    bool define(std::string const &name, Symbol s)
+    void add(Symbol *s)
     {
-        if (symbol_table_.contains(name)) {
-            return false;
-        }
-        symbol_table_.insert({name, std::make_unique<Symbol>(std::move(s))});
-        return true;
+        symbols_.push_back(s);
     }
 
     Symbol *lookup(std::string const &name)
     {
-        if (auto it = symbol_table_.find(name); it != symbol_table_.end()) {
-            return it->second.get();
-        }
-        return nullptr;
+        auto it = std::ranges::find(symbols_, name, &Symbol::name);
+        return it != symbols_.end() ? *it : nullptr;
     }
 
     void dump(std::size_t indent) const
     {
         spdlog::debug("{}Symbol Table:", indent_string(indent));
-        for (auto const &[name, symbol] : symbol_table_) {
-            spdlog::debug("{}    {} -> {}", indent_string(indent), name,
+        for (auto const *symbol : symbols_) {
+            spdlog::debug("{}    {} -> {}", indent_string(indent), symbol->name,
                           symbol->type_ptr->canonical_name());
         }
     }
 
   private:
-    std::unordered_map<std::string, std::unique_ptr<Symbol>> symbol_table_;
+    std::vector<Symbol *> symbols_;
 };
 
 } // namespace semantic
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <semantic/type.h>
 
 namespace semantic {
@@ -8,11 +9,20 @@ enum class SymbolKind : unsigned char {
     variable,
 };
 
+/// @brief Where the value of a variable lives at run time.
+enum class StorageKind : unsigned char {
+    none, // Functions and types
+    global,
+    local, // In the frame of the enclosing function
+};
+
 struct Symbol {
   public:
     std::string name;
     Type *type_ptr;
     SymbolKind symbolkind;
+    StorageKind storage{};
+    std::uint32_t slot{}; // Index into the global or function frame
 };
 
 } // namespace semantic
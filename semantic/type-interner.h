@@ -0,0 +1,174 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <semantic/arena.h>
+#include <semantic/type.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace semantic {
+
+/// @brief Hash-conses types so that each distinct type exists exactly once.
+///
+/// Components of a composite type are canonical themselves, so structural
+/// hashing only needs to combine their addresses. Two types are equal iff
+/// they are the same object, i.e. iff their ids are equal.
+///
+/// The interner is safe to share between threads; a type is immutable once
+/// it has been handed out.
+class TypeInterner {
+  public:
+    BuiltinType *builtin_type(BuiltinType::Kind kind, std::size_t size)
+    {
+        std::scoped_lock lock(mutex_);
+        if (auto it = builtins_.find(kind); it != builtins_.end()) {
+            return it->second;
+        }
+        auto *p = add<BuiltinType>(size, kind);
+        builtins_.insert({kind, p});
+        return p;
+    }
+
+    ArrayType *array_type(Type *element_type, std::size_t length)
+    {
+        std::scoped_lock lock(mutex_);
+        ArrayKey key{.element_type = element_type, .length = length};
+        if (auto it = arrays_.find(key); it != arrays_.end()) {
+            return it->second;
+        }
+        auto *p = add<ArrayType>(element_type, length);
+        // Arrays decay to a pointer to their element type
+        p->add_convertible(pointer_type_unlocked(element_type));
+        arrays_.insert({key, p});
+        return p;
+    }
+
+    PointerType *pointer_type(Type *pointee_type)
+    {
+        std::scoped_lock lock(mutex_);
+        return pointer_type_unlocked(pointee_type);
+    }
+
+    // Each function declaration has a function type of its own, as the type
+    // also carries the declaration.
+    FunctionType *function_type(Type *return_type,
+                                std::vector<Type *> const &parameter_types,
+                                ast::FunctionDeclaration *decl)
+    {
+        std::scoped_lock lock(mutex_);
+        FunctionKey key{.return_type = return_type,
+                        .parameter_types = parameter_types,
+                        .decl = decl};
+        if (auto it = functions_.find(key); it != functions_.end()) {
+            return it->second;
+        }
+        auto *p = add<FunctionType>(return_type, parameter_types, decl);
+        functions_.insert({std::move(key), p});
+        return p;
+    }
+
+    /// @brief Finds an existing pointer type without creating it.
+    [[nodiscard]] PointerType *find_pointer_type(Type *pointee_type) const
+    {
+        std::scoped_lock lock(mutex_);
+        if (auto it = pointers_.find(pointee_type); it != pointers_.end()) {
+            return it->second;
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] Type *type(TypeId id) const
+    {
+        std::scoped_lock lock(mutex_);
+        return types_.at(id);
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        std::scoped_lock lock(mutex_);
+        return types_.size();
+    }
+
+    void dump(std::size_t indent) const
+    {
+        std::scoped_lock lock(mutex_);
+        spdlog::debug("{}Types:", indent_string(indent));
+        for (auto const &type : types_) {
+            spdlog::debug("{}#{}: {}", indent_string(indent + 1), type->id,
+                          type->canonical_name());
+        }
+    }
+
+  private:
+    struct ArrayKey {
+        Type *element_type;
+        std::size_t length;
+
+        bool operator==(ArrayKey const &) const = default;
+    };
+
+    struct FunctionKey {
+        Type *return_type;
+        std::vector<Type *> parameter_types;
+        ast::FunctionDeclaration *decl;
+
+        bool operator==(FunctionKey const &) const = default;
+    };
+
+    static void hash_combine(std::size_t &seed, std::size_t h) noexcept
+    {
+        seed ^= h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    }
+
+    struct KeyHash {
+        std::size_t operator()(ArrayKey const &k) const noexcept
+        {
+            std::size_t seed = std::hash<Type *>{}(k.element_type);
+            hash_combine(seed, k.length);
+            return seed;
+        }
+
+        std::size_t operator()(FunctionKey const &k) const noexcept
+        {
+            std::size_t seed = std::hash<Type *>{}(k.return_type);
+            for (auto *p : k.parameter_types) {
+                hash_combine(seed, std::hash<Type *>{}(p));
+            }
+            hash_combine(seed, std::hash<ast::FunctionDeclaration *>{}(k.decl));
+            return seed;
+        }
+    };
+
+    PointerType *pointer_type_unlocked(Type *pointee_type)
+    {
+        if (auto it = pointers_.find(pointee_type); it != pointers_.end()) {
+            return it->second;
+        }
+        auto *p = add<PointerType>(pointee_type);
+        pointers_.insert({pointee_type, p});
+        return p;
+    }
+
+    template <typename T, typename... Args> T *add(Args &&...args)
+    {
+        auto *p = arena_.make<T>(std::forward<Args>(args)...);
+        p->id = static_cast<TypeId>(types_.size());
+        p->add_convertible(p); // Every type converts to itself
+        types_.push_back(p);
+        return p;
+    }
+
+    mutable std::mutex mutex_;
+
+    Arena arena_;
+    std::vector<Type *> types_; // Indexed by TypeId
+
+    std::unordered_map<BuiltinType::Kind, BuiltinType *> builtins_;
+    std::unordered_map<ArrayKey, ArrayType *, KeyHash> arrays_;
+    std::unordered_map<Type *, PointerType *> pointers_;
+    std::unordered_map<FunctionKey, FunctionType *, KeyHash> functions_;
+};
+
+} // namespace semantic
@@ -1,9 +1,8 @@
 #pragma once
 // #include <ast/ast.h>
+#include <cstdint>
 #include <helper.h>
 #include <memory>
-#include <ranges>
-#include <set>
 #include <spdlog/spdlog.h>
 #include <string>
 #include <vector>
@@ -16,6 +15,9 @@ class FunctionDeclaration;
 
 namespace semantic {
 
+/// Index of a canonical type in the TypeInterner.
+using TypeId = std::uint32_t;
+
 enum class TypeKind : unsigned char {
     function_type,
     builtin_type,
@@ -48,7 +50,7 @@ struct Type {
     Type &operator=(Type const &) = default;
     Type &operator=(Type &&) = delete;
     Type(std::size_t type_size, TypeKind typekind)
-        : type_size(type_size), typekind(typekind), convertible_set_{this}
+        : type_size(type_size), typekind(typekind)
     {
     }
     virtual ~Type() = default;
@@ -57,25 +59,46 @@ struct Type {
 
     bool convertible_to(Type *rhs) const
     {
-        return convertible_set_.contains(rhs);
+        auto word = rhs->id / 64;
+        return word < convertible_ids_.size() &&
+               ((convertible_ids_[word] >> (rhs->id % 64)) & 1U) != 0;
     }
 
-    bool convertible_to(TypeKind tk)
+    bool convertible_to(TypeKind tk) const
     {
-        auto typekind_set =
-            convertible_set_ |
-            std::views::transform([](Type *ele) { return ele->typekind; }) |
-            std::ranges::to<std::set<TypeKind>>();
-        return typekind_set.contains(tk);
+        return (convertible_kinds_ & kind_bit(tk)) != 0;
     }
 
-    [[nodiscard]] virtual std::string canonical_name() const = 0;
+    /// @brief Records that this type converts to `target`. Called once per
+    /// conversion, when the types are interned, so that queries afterwards
+    /// are a bit test.
+    void add_convertible(Type *target)
+    {
+        auto word = target->id / 64;
+        if (word >= convertible_ids_.size()) {
+            convertible_ids_.resize(word + 1);
+        }
+        convertible_ids_[word] |= std::uint64_t{1} << (target->id % 64);
+        convertible_kinds_ |= kind_bit(target->typekind);
+    }
 
-    auto operator<=>(Type const &other) const noexcept = default;
+    [[nodiscard]] virtual std::string canonical_name() const = 0;
 
+    TypeId id{}; // Assigned by the TypeInterner
     std::size_t type_size;
-    TypeKind typekind;                 // Only behave as a tag
-    std::set<Type *> convertible_set_; // Convertible to
+    TypeKind typekind; // Only behave as a tag
+
+  private:
+    static constexpr std::uint8_t kind_bit(TypeKind tk)
+    {
+        return static_cast<std::uint8_t>(1U << static_cast<unsigned>(tk));
+    }
+
+    // Row of the convertibility matrix: bit i is set iff this type converts
+    // to the type whose id is i.
+    std::vector<std::uint64_t> convertible_ids_;
+    // Kinds of all types in convertible_ids_
+    std::uint8_t convertible_kinds_{};
 };
 
 struct BuiltinType : public Type {
@@ -156,8 +179,6 @@ struct FunctionType : public Type {
         return result;
     }
 
-    auto operator<=>(FunctionType const &other) const noexcept = default;
-
     Type *return_type;
     std::vector<Type *> parameter_types;
     ast::FunctionDeclaration *decl;
@@ -170,8 +191,6 @@ struct ArrayType : public Type {
     {
     }
 
-    auto operator<=>(ArrayType const &other) const noexcept = default;
-
     void dump(std::size_t indent = 0) override
     {
         spdlog::debug("{}ArrayType:", indent_string(indent));
@@ -186,6 +205,19 @@ struct ArrayType : public Type {
                "]";
     }
 
+    /// @brief The lengths of the dimensions, outermost first: {4, 3} for
+    /// int[3][4].
+    [[nodiscard]] std::vector<std::size_t> dimensions() const
+    {
+        std::vector<std::size_t> result{length};
+        for (auto *t = element_type; t->typekind == TypeKind::array_type;) {
+            auto *at = static_cast<ArrayType *>(t);
+            result.push_back(at->length);
+            t = at->element_type;
+        }
+        return result;
+    }
+
     Type *element_type;
     std::size_t length;
 };
@@ -209,8 +241,6 @@ struct PointerType : public Type {
         return pointee_type->canonical_name() + "*";
     }
 
-    auto operator<=>(PointerType const &other) const noexcept = default;
-
     Type *pointee_type;
 };
 
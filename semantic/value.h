@@ -0,0 +1,233 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace semantic {
+
+struct Array;
+
+/// @brief A run-time value of the interpreter: a tag and a 64-bit payload.
+///
+/// Strings are interned, so copying a string value copies a pointer. Arrays
+/// are referenced; their storage belongs to the interpreter.
+class Value {
+  public:
+    enum class Kind : unsigned char {
+        none, // Uninitialized
+        integer,
+        floating,
+        string,
+        array,
+    };
+
+    Value() = default;
+    explicit Value(std::int64_t i) : kind_(Kind::integer), i_(i) {}
+    explicit Value(double f) : kind_(Kind::floating), f_(f) {}
+    explicit Value(std::string const *s) : kind_(Kind::string), s_(s) {}
+    explicit Value(Array *a) : kind_(Kind::array), a_(a) {}
+
+    [[nodiscard]] Kind kind() const
+    {
+        return kind_;
+    }
+
+    // The accessors don't check the tag: the analyzer has checked the types
+    // of all operations already.
+
+    [[nodiscard]] std::int64_t as_int() const
+    {
+        return i_;
+    }
+
+    [[nodiscard]] double as_float() const
+    {
+        return f_;
+    }
+
+    [[nodiscard]] std::string const &as_string() const
+    {
+        return *s_;
+    }
+
+    [[nodiscard]] Array *as_array() const
+    {
+        return a_;
+    }
+
+    /// @brief The payload as raw bits: values of the same kind are the same
+    /// value iff their bits are equal.
+    [[nodiscard]] std::uint64_t bits() const
+    {
+        switch (kind_) {
+        case Kind::none:
+            return 0;
+        case Kind::integer:
+            return std::bit_cast<std::uint64_t>(i_);
+        case Kind::floating:
+            return std::bit_cast<std::uint64_t>(f_);
+        case Kind::string:
+            return reinterpret_cast<std::uintptr_t>(s_);
+        case Kind::array:
+            return reinterpret_cast<std::uintptr_t>(a_);
+        }
+        throw std::logic_error{"Invalid value kind"};
+    }
+
+    [[nodiscard]] std::string to_string() const;
+
+  private:
+    Kind kind_{Kind::none};
+    union {
+        std::int64_t i_{};
+        double f_;
+        std::string const *s_;
+        Array *a_;
+    };
+};
+
+/// @brief An array, or a row of a multidimensional one.
+///
+/// The values of an array are contiguous, in row-major order: element i is
+/// the value data[i], or if the elements are rows, the `stride` values from
+/// data + i * stride. Rows are views into them, made along with the array.
+/// The rows of one dimension are contiguous too, so that the row at a flat
+/// index of a dimension is found without walking the dimensions above it.
+struct Array {
+    Value *data;
+    std::size_t length;
+    std::size_t stride; // Values per element, 1 unless the elements are rows
+    Array *rows;        // The elements if they are rows, else nullptr
+};
+
+inline std::string Value::to_string() const
+{
+    switch (kind_) {
+    case Kind::none:
+        return "<uninitialized>";
+    case Kind::integer:
+        return std::to_string(i_);
+    case Kind::floating:
+        return std::format("{}", f_);
+    case Kind::string:
+        return *s_;
+    case Kind::array:
+        return std::format("<array of {}>", a_->length);
+    }
+    throw std::logic_error{"Invalid value kind"};
+}
+
+/// @brief Owns the strings referenced by values. Equal strings are stored
+/// once.
+class StringPool {
+  public:
+    std::string const *intern(std::string_view s)
+    {
+        return &*strings_.emplace(s).first;
+    }
+
+  private:
+    std::unordered_set<std::string> strings_; // Node-based, so pointer-stable
+};
+
+/// @brief Owns the arrays referenced by values. Arrays live until released,
+/// e.g. with their frame (see EscapeAnalysis), or until the pool dies; the
+/// storage of released arrays is reused.
+class ArrayPool {
+  public:
+    /// @brief Makes an array of uninitialized values whose dimensions have
+    /// `lengths`, outermost first.
+    Array *make(std::span<std::size_t const> lengths)
+    {
+        std::unique_ptr<Storage> owner;
+        if (free_.empty()) {
+            owner = std::make_unique<Storage>();
+        }
+        else {
+            owner = std::move(free_.back());
+            free_.pop_back();
+        }
+        auto &storage = *owner;
+        // Values per element of each dimension
+        std::vector<std::size_t> strides(lengths.size(), 1);
+        for (auto d = lengths.size() - 1; d > 0; --d) {
+            strides[d - 1] = strides[d] * lengths[d];
+        }
+        std::size_t rows = 1; // Of the dimension, across the array
+        std::size_t views = 0;
+        for (auto length : lengths) {
+            views += rows;
+            rows *= length;
+        }
+        storage.values.assign(strides[0] * lengths[0], Value{});
+        storage.views.resize(views);
+
+        // Level by level, each view's rows following on the next level
+        std::size_t level = 0;
+        rows = 1;
+        for (std::size_t d = 0; d < lengths.size(); ++d) {
+            auto next = level + rows;
+            for (std::size_t r = 0; r < rows; ++r) {
+                storage.views[level + r] = {
+                    .data = storage.values.data() + r * lengths[d] * strides[d],
+                    .length = lengths[d],
+                    .stride = strides[d],
+                    .rows = d + 1 < lengths.size()
+                                ? storage.views.data() + next + r * lengths[d]
+                                : nullptr,
+                };
+            }
+            level = next;
+            rows *= lengths[d];
+        }
+        auto *array = storage.views.data();
+        live_.emplace(array, std::move(owner));
+        return array;
+    }
+
+    /// @brief Frees `array`, made by this pool and not a row. Values
+    /// referencing it or its rows dangle.
+    void release(Array *array)
+    {
+        auto it = live_.find(array);
+        if (it == live_.end()) {
+            throw std::logic_error{"Releasing an array not made by the pool"};
+        }
+        free_.push_back(std::move(it->second));
+        live_.erase(it);
+    }
+
+    /// @brief Releases the array `value` holds, if any, and clears it.
+    void release(Value &value)
+    {
+        if (value.kind() == Value::Kind::array) {
+            release(value.as_array());
+            value = Value{};
+        }
+    }
+
+    /// @brief Number of arrays made and not released.
+    [[nodiscard]] std::size_t live() const
+    {
+        return live_.size();
+    }
+
+  private:
+    struct Storage {
+        std::vector<Value> values;
+        std::vector<Array> views; // The array, then its rows level by level
+    };
+
+    std::unordered_map<Array const *, std::unique_ptr<Storage>> live_;
+    std::vector<std::unique_ptr<Storage>> free_;
+};
+
+} // namespace semantic
@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// @brief A fixed-size pool of worker threads consuming a FIFO task queue.
+class ThreadPool {
+  public:
+    explicit ThreadPool(
+        std::size_t threads = std::max(1U, std::thread::hardware_concurrency()))
+    {
+        workers_.reserve(threads);
+        for (std::size_t i = 0; i != threads; ++i) {
+            workers_.emplace_back([this] { work(); });
+        }
+    }
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::scoped_lock lock(mutex_);
+            stopping_ = true;
+        }
+        task_available_.notify_all();
+        // std::jthread joins on destruction
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        return workers_.size();
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::scoped_lock lock(mutex_);
+            tasks_.push_back(std::move(task));
+            ++unfinished_;
+        }
+        task_available_.notify_one();
+    }
+
+    /// @brief Blocks until every submitted task has finished. Rethrows the
+    /// first exception thrown by a task, if any.
+    void wait()
+    {
+        std::unique_lock lock(mutex_);
+        all_done_.wait(lock, [this] { return unfinished_ == 0; });
+        if (auto e = std::exchange(first_exception_, nullptr)) {
+            std::rethrow_exception(e);
+        }
+    }
+
+  private:
+    void work()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex_);
+                task_available_.wait(
+                    lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return; // Stopping
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+
+            std::exception_ptr e;
+            try {
+                task();
+            }
+            catch (...) {
+                e = std::current_exception();
+            }
+
+            std::scoped_lock lock(mutex_);
+            if (e && !first_exception_) {
+                first_exception_ = e;
+            }
+            if (--unfinished_ == 0) {
+                all_done_.notify_all();
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::condition_variable all_done_;
+    std::deque<std::function<void()>> tasks_;
+    std::size_t unfinished_{};
+    bool stopping_{};
+    std::exception_ptr first_exception_;
+    std::vector<std::jthread> workers_;
+};
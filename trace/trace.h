@@ -0,0 +1,159 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <lex/token.h>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Execution tracing. Hooks are written as HLVM_TRACE_EVENT(...): unless the
+// build defines HLVM_TRACE (the CMake option of the same name), they compile
+// to nothing. Otherwise each hook tests whether the thread has a sink, and
+// only then evaluates its arguments and appends a binary record.
+#if HLVM_TRACE
+#define HLVM_TRACE_EVENT(event, range, value)                                  \
+    do {                                                                       \
+        if (auto *hlvm_trace_sink = ::trace::sink()) [[unlikely]] {            \
+            hlvm_trace_sink->write(                                            \
+                ::trace::make_record(::trace::Event::event, range, value));    \
+        }                                                                      \
+    } while (false)
+#else
+#define HLVM_TRACE_EVENT(event, range, value)                                  \
+    do {                                                                       \
+    } while (false)
+#endif
+
+namespace trace {
+
+enum class Event : std::uint8_t {
+    statement,      // value: 0
+    call,           // value: number of arguments
+    ret,            // value: returned integer, if any
+    branch,         // value: 1 if the true branch is taken, else 0
+    loop_iteration, // value: iterations so far, counting this one
+};
+
+inline std::string_view to_string(Event event)
+{
+    switch (event) {
+    case Event::statement:
+        return "statement";
+    case Event::call:
+        return "call";
+    case Event::ret:
+        return "ret";
+    case Event::branch:
+        return "branch";
+    case Event::loop_iteration:
+        return "loop_iteration";
+    }
+    return "unknown";
+}
+
+/// @brief One traced event, at the source range of the node causing it.
+struct Record {
+    std::uint64_t timestamp; // Nanoseconds of the steady clock
+    std::int64_t value;
+    std::uint32_t row;
+    std::uint16_t column;
+    Event event;
+};
+static_assert(sizeof(Record) == 24);
+
+inline Record make_record(Event event, SourceRange const &range,
+                          std::int64_t value)
+{
+    return {.timestamp = static_cast<std::uint64_t>(
+                std::chrono::steady_clock::now().time_since_epoch().count()),
+            .value = value,
+            .row = static_cast<std::uint32_t>(range.begin.row),
+            .column = static_cast<std::uint16_t>(range.begin.column),
+            .event = event};
+}
+
+/// @brief Keeps the most recent records, overwriting the oldest once full.
+class RingBuffer {
+  public:
+    static constexpr std::size_t default_capacity = 1 << 16;
+
+    /// @brief `capacity` is rounded up to a power of two.
+    explicit RingBuffer(std::size_t capacity = default_capacity)
+        : records_(std::bit_ceil(std::max<std::size_t>(capacity, 1))),
+          mask_(records_.size() - 1)
+    {
+    }
+
+    void write(Record const &record)
+    {
+        records_[written_++ & mask_] = record;
+    }
+
+    /// @brief Number of records written, including the overwritten ones.
+    [[nodiscard]] std::uint64_t written() const
+    {
+        return written_;
+    }
+
+    /// @brief The records kept, oldest first.
+    [[nodiscard]] std::vector<Record> snapshot() const
+    {
+        auto size = std::min<std::uint64_t>(written_, records_.size());
+        std::vector<Record> result;
+        result.reserve(size);
+        for (auto i = written_ - size; i != written_; ++i) {
+            result.push_back(records_[i & mask_]);
+        }
+        return result;
+    }
+
+    /// @brief Writes the records kept, oldest first, after a header: the
+    /// magic "HLVMTRC1", then the record size and the record count as
+    /// 64-bit integers. Everything is in native byte order.
+    void write_to(std::ostream &os) const
+    {
+        auto records = snapshot();
+        std::uint64_t header[] = {sizeof(Record), records.size()};
+        os.write("HLVMTRC1", 8);
+        os.write(reinterpret_cast<char const *>(header), sizeof(header));
+        os.write(reinterpret_cast<char const *>(records.data()),
+                 static_cast<std::streamsize>(records.size() * sizeof(Record)));
+    }
+
+  private:
+    std::vector<Record> records_;
+    std::size_t mask_;
+    std::uint64_t written_{};
+};
+
+/// @brief The sink of the calling thread, or nullptr if tracing is off.
+inline RingBuffer *&sink()
+{
+    thread_local RingBuffer *current{};
+    return current;
+}
+
+/// @brief Traces the calling thread into a buffer during its lifetime.
+class Session {
+  public:
+    explicit Session(RingBuffer *buffer) : previous_(sink())
+    {
+        sink() = buffer;
+    }
+    Session(Session const &) = delete;
+    Session(Session &&) = delete;
+    Session &operator=(Session const &) = delete;
+    Session &operator=(Session &&) = delete;
+    ~Session()
+    {
+        sink() = previous_;
+    }
+
+  private:
+    RingBuffer *previous_;
+};
+
+} // namespace trace
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <print>
+#include <semantic/type.h>
+#include <semantic/value.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vm {
+
+// Listed once, so that the enum, the names and the dispatch table of the VM
+// can't disagree on the order.
+#define HLVM_VM_OPS(X)                                                         \
+    X(push_const)   /* constants[operand] */                                   \
+    X(pop)                                                                     \
+    X(dup)                                                                     \
+    X(load_local)   /* operand: slot */                                        \
+    X(store_local)  /* Pops */                                                 \
+    X(load_global)  /* operand: slot */                                        \
+    X(store_global) /* Pops */                                                 \
+    X(new_array)    /* array_types[operand] */                                 \
+    X(release_local) /* operand: slot, whose array is freed */                 \
+    /* Offsets are row-major, checked against the array by the accesses */     \
+    X(index_madd)    /* offset, index -> offset * operand + index */           \
+    X(index_madd_checked) /* The same, failing unless index < operand */       \
+    X(load_element)  /* array, offset -> value */                              \
+    X(load_row)      /* array, offset -> row in dimension operand */           \
+    X(store_element) /* value, array, offset -> */                             \
+    X(int_add)                                                                 \
+    X(int_sub)                                                                 \
+    X(int_mul)                                                                 \
+    X(int_div)                                                                 \
+    X(int_mod)                                                                 \
+    X(int_eq)                                                                  \
+    X(int_lt)                                                                  \
+    X(int_le)                                                                  \
+    X(int_gt)                                                                  \
+    X(int_ge)                                                                  \
+    X(int_neg)                                                                 \
+    X(float_add)                                                               \
+    X(float_sub)                                                               \
+    X(float_mul)                                                               \
+    X(float_div)                                                               \
+    X(float_eq)                                                                \
+    X(float_lt)                                                                \
+    X(float_le)                                                                \
+    X(float_gt)                                                                \
+    X(float_ge)                                                                \
+    X(float_neg)                                                               \
+    X(jump)          /* operand: target */                                     \
+    X(jump_if_false) /* Pops the condition */                                  \
+    X(call)          /* functions[operand] */                                  \
+    X(tail_call)     /* functions[operand], replacing the frame */             \
+    X(print)         /* Replaces the value by integer 0 */                     \
+    X(ret)
+
+enum class Op : std::uint8_t {
+#define HLVM_VM_ENUM(name) name,
+    HLVM_VM_OPS(HLVM_VM_ENUM)
+#undef HLVM_VM_ENUM
+};
+
+inline std::string_view to_string(Op op)
+{
+    switch (op) {
+#define HLVM_VM_NAME(name)                                                     \
+    case Op::name:                                                             \
+        return #name;
+        HLVM_VM_OPS(HLVM_VM_NAME)
+#undef HLVM_VM_NAME
+    }
+    return "unknown";
+}
+
+/// @brief One instruction: an opcode and a single immediate operand, whose
+/// meaning depends on the opcode.
+struct Instruction {
+    Op op;
+    std::uint32_t operand{};
+};
+static_assert(sizeof(Instruction) == 8);
+
+struct Function {
+    std::string name;
+    std::vector<Instruction> code;
+    std::uint32_t parameter_count{};
+    std::uint32_t frame_size{}; // Parameters take the first slots
+    std::uint32_t max_stack{};  // Operand stack depth above the frame
+    std::vector<std::uint32_t> frame_arrays; // Slots freed on leaving
+};
+
+/// @brief A compiled program. `entry` initializes the globals, then calls
+/// 'main' and returns what it returns.
+struct Module {
+    void dump(std::ostream &os) const
+    {
+        for (std::size_t i = 0; i < functions.size(); ++i) {
+            auto const &f = functions[i];
+            std::println(os, "#{} {}: params {}, frame {}, stack {}", i, f.name,
+                         f.parameter_count, f.frame_size, f.max_stack);
+            for (std::size_t pc = 0; pc < f.code.size(); ++pc) {
+                auto const &ins = f.code[pc];
+                std::println(os, "  {:4} {:14} {}", pc, to_string(ins.op),
+                             ins.operand);
+            }
+        }
+    }
+
+    std::vector<Function> functions;
+    std::uint32_t entry{};
+    std::vector<semantic::Value> constants;
+    std::vector<semantic::ArrayType const *> array_types;
+    std::uint32_t global_count{};
+    semantic::StringPool strings; // Referenced by string constants
+};
+
+} // namespace vm
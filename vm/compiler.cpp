@@ -0,0 +1,404 @@
+#include <vm/compiler.h>
+
+#include <algorithm>
+#include <ast/parallel-function-visitor.h>
+#include <semantic/scope.h>
+#include <semantic/symbol.h>
+#include <stdexcept>
+
+namespace {
+
+vm::Op to_op(semantic::OpCode opcode)
+{
+    using enum semantic::OpCode;
+
+    switch (opcode) {
+    case int_add:
+        return vm::Op::int_add;
+    case int_sub:
+        return vm::Op::int_sub;
+    case int_mul:
+        return vm::Op::int_mul;
+    case int_div:
+        return vm::Op::int_div;
+    case int_mod:
+        return vm::Op::int_mod;
+    case int_eq:
+        return vm::Op::int_eq;
+    case int_lt:
+        return vm::Op::int_lt;
+    case int_le:
+        return vm::Op::int_le;
+    case int_gt:
+        return vm::Op::int_gt;
+    case int_ge:
+        return vm::Op::int_ge;
+    case int_neg:
+        return vm::Op::int_neg;
+    case float_add:
+        return vm::Op::float_add;
+    case float_sub:
+        return vm::Op::float_sub;
+    case float_mul:
+        return vm::Op::float_mul;
+    case float_div:
+        return vm::Op::float_div;
+    case float_eq:
+        return vm::Op::float_eq;
+    case float_lt:
+        return vm::Op::float_lt;
+    case float_le:
+        return vm::Op::float_le;
+    case float_gt:
+        return vm::Op::float_gt;
+    case float_ge:
+        return vm::Op::float_ge;
+    case float_neg:
+        return vm::Op::float_neg;
+    default:
+        throw std::logic_error(std::format("Opcode {} has no instruction",
+                                           semantic::to_string(opcode)));
+    }
+}
+
+} // namespace
+
+vm::Compiler::Compiler(Diagnostics *diags) : diags_(diags) {}
+
+vm::Module vm::Compiler::compile(ast::Program &prog)
+{
+    module_ = {};
+    function_index_.clear();
+    int_constants_.clear();
+    module_.global_count = prog.global_frame_size();
+
+    // Indices first, so that calls may precede their callees
+    auto fds = ast::function_declarations(prog);
+    for (auto *fd : fds) {
+        function_index_[fd] = module_.functions.size();
+        module_.functions.push_back(
+            {.name = fd->name(),
+             .parameter_count =
+                 static_cast<std::uint32_t>(fd->parameters().size()),
+             .frame_size = static_cast<std::uint32_t>(fd->frame_size()),
+             .frame_arrays = fd->frame_arrays()});
+    }
+
+    auto *main = prog.global_scope()->lookup_symbol("main");
+    if (main == nullptr ||
+        main->type_ptr->typekind != semantic::TypeKind::function_type) {
+        diags_->error("Cannot find function 'main'");
+        return std::move(module_);
+    }
+
+    module_.entry = module_.functions.size();
+    function_ = &module_.functions.emplace_back(Function{.name = "<entry>"});
+    depth_ = 0;
+    for (auto const &ds : prog.declaration_statements()) {
+        if (dynamic_cast<ast::VariableDeclaration *>(ds->declaration().get()) !=
+            nullptr) {
+            ds->accept(*this);
+        }
+    }
+    emit(Op::call,
+         function_index_.at(
+             static_cast<semantic::FunctionType *>(main->type_ptr)->decl));
+    emit(Op::ret);
+
+    for (auto *fd : fds) {
+        fd->accept(*this);
+    }
+    return std::move(module_);
+}
+
+void vm::Compiler::visit(ast::VariableDeclaration &vd)
+{
+    auto *type = vd.resolved_type();
+    if (vd.init()) {
+        vd.init()->accept(*this);
+    }
+    else if (type != nullptr &&
+             type->typekind == semantic::TypeKind::array_type) {
+        if (vd.owns_array()) {
+            emit(Op::release_local, vd.symbol()->slot); // Of the last run
+        }
+        module_.array_types.push_back(
+            static_cast<semantic::ArrayType *>(type));
+        emit(Op::new_array, module_.array_types.size() - 1);
+    }
+    else {
+        emit(Op::push_const, constant(semantic::Value{}));
+    }
+    store(vd.symbol());
+}
+
+void vm::Compiler::visit(ast::FunctionDeclaration &fd)
+{
+    function_ = &module_.functions[function_index_.at(&fd)];
+    depth_ = 0;
+    fd.body()->accept(*this);
+    // Falls off the end
+    emit(Op::push_const, constant(semantic::Value{}));
+    emit(Op::ret);
+}
+
+void vm::Compiler::visit(ast::ExpressionStatement &es)
+{
+    auto *be = dynamic_cast<ast::BinaryExpression *>(es.expr().get());
+    if (be != nullptr && be->opcode() == semantic::OpCode::assign) {
+        assignment(*be, false);
+        return;
+    }
+    es.expr()->accept(*this);
+    emit(Op::pop);
+}
+
+void vm::Compiler::visit(ast::ReturnStatement &rs)
+{
+    auto *ce = dynamic_cast<ast::CallExpression *>(rs.returned_value().get());
+    if (ce != nullptr && ce->target() != nullptr) {
+        for (auto const &arg : ce->arguments()) {
+            arg->accept(*this);
+        }
+        // The return only runs after a call to native code
+        emit(Op::tail_call, function_index_.at(ce->target()));
+        emit(Op::ret);
+        return;
+    }
+    if (rs.returned_value()) {
+        rs.returned_value()->accept(*this);
+    }
+    else {
+        emit(Op::push_const, constant(semantic::Value{}));
+    }
+    emit(Op::ret);
+}
+
+void vm::Compiler::visit(ast::IfStatement &is)
+{
+    is.condition()->accept(*this);
+    auto to_false = emit(Op::jump_if_false);
+    is.true_branch()->accept(*this);
+    if (!is.false_branch()) {
+        patch(to_false);
+        return;
+    }
+    auto to_end = emit(Op::jump);
+    patch(to_false);
+    is.false_branch()->accept(*this);
+    patch(to_end);
+}
+
+void vm::Compiler::visit(ast::WhileStatement &ws)
+{
+    auto begin = static_cast<std::uint32_t>(function_->code.size());
+    ws.condition()->accept(*this);
+    auto to_end = emit(Op::jump_if_false);
+    ws.body()->accept(*this);
+    emit(Op::jump, begin);
+    patch(to_end);
+}
+
+void vm::Compiler::visit(ast::CallExpression &ce)
+{
+    if (ce.builtin() == semantic::Builtin::print) {
+        ce.arguments().front()->accept(*this);
+        emit(Op::print);
+        return;
+    }
+    if (ce.target() == nullptr) {
+        diags_->error("{}: Callee is not a function", ce.source_range());
+        return;
+    }
+    for (auto const &arg : ce.arguments()) {
+        arg->accept(*this);
+    }
+    emit(Op::call, function_index_.at(ce.target()));
+}
+
+void vm::Compiler::visit(ast::IndexExpression &ie)
+{
+    auto dimension = index(ie);
+    if (ie.type()->typekind == semantic::TypeKind::array_type) {
+        emit(Op::load_row, dimension);
+    }
+    else {
+        emit(Op::load_element);
+    }
+}
+
+void vm::Compiler::visit(ast::UnaryExpression &ue)
+{
+    ue.expr()->accept(*this);
+    if (ue.opcode() != semantic::OpCode::identity) {
+        emit(to_op(ue.opcode()));
+    }
+}
+
+void vm::Compiler::visit(ast::BinaryExpression &be)
+{
+    if (be.opcode() == semantic::OpCode::assign) {
+        assignment(be, true);
+        return;
+    }
+    // Right to left, like the tree walker, so the left operand ends up on top
+    be.rhs()->accept(*this);
+    be.lhs()->accept(*this);
+    emit(to_op(be.opcode()));
+}
+
+void vm::Compiler::visit(ast::IdentifierExpression &ie)
+{
+    load(ie.symbol());
+}
+
+void vm::Compiler::visit(ast::IntegerLiteralExpr &ie)
+{
+    emit(Op::push_const, int_constant(ie.value()));
+}
+
+void vm::Compiler::visit(ast::FloatLiteralExpr &fe)
+{
+    emit(Op::push_const, constant(semantic::Value{std::stod(fe.value())}));
+}
+
+void vm::Compiler::visit(ast::StringLiteralExpr &se)
+{
+    emit(Op::push_const,
+         constant(semantic::Value{module_.strings.intern(se.value())}));
+}
+
+std::uint32_t vm::Compiler::emit(Op op, std::uint32_t operand)
+{
+    int effect{};
+    switch (op) {
+    case Op::push_const:
+    case Op::dup:
+    case Op::load_local:
+    case Op::load_global:
+    case Op::new_array:
+        effect = 1;
+        break;
+    case Op::call:
+    case Op::tail_call:
+        effect = 1 - static_cast<int>(
+                         module_.functions[operand].parameter_count);
+        break;
+    case Op::store_element:
+        effect = -3;
+        break;
+    case Op::release_local:
+    case Op::int_neg:
+    case Op::float_neg:
+    case Op::jump:
+    case Op::print:
+        break;
+    default: // Binary operators, and the others popping one value
+        effect = -1;
+        break;
+    }
+    depth_ += effect;
+    function_->max_stack =
+        std::max(function_->max_stack, static_cast<std::uint32_t>(depth_));
+
+    function_->code.push_back({.op = op, .operand = operand});
+    return function_->code.size() - 1;
+}
+
+void vm::Compiler::patch(std::uint32_t at)
+{
+    function_->code[at].operand = function_->code.size();
+}
+
+std::uint32_t vm::Compiler::constant(semantic::Value value)
+{
+    module_.constants.push_back(value);
+    return module_.constants.size() - 1;
+}
+
+std::uint32_t vm::Compiler::int_constant(std::int64_t value)
+{
+    auto [it, inserted] = int_constants_.try_emplace(value);
+    if (inserted) {
+        it->second = constant(semantic::Value{value});
+    }
+    return it->second;
+}
+
+void vm::Compiler::assignment(ast::BinaryExpression &be, bool keep)
+{
+    be.rhs()->accept(*this);
+    if (keep) {
+        emit(Op::dup);
+    }
+    if (auto *ie = dynamic_cast<ast::IdentifierExpression *>(be.lhs().get())) {
+        store(ie->symbol());
+    }
+    else if (auto *ie = dynamic_cast<ast::IndexExpression *>(be.lhs().get())) {
+        index(*ie); // Of a value, rows not being assignable
+        emit(Op::store_element);
+    }
+    else {
+        diags_->error("{}: Left-hand side of assignment expression not an "
+                      "lvalue",
+                      be.source_range());
+    }
+}
+
+std::uint32_t vm::Compiler::index(ast::IndexExpression &ie)
+{
+    // a[i][j] is (a[i])[j]: offset i * length + j, length being that of
+    // the dimension j indexes
+    std::uint32_t dimension = 1;
+    if (auto *base = dynamic_cast<ast::IndexExpression *>(ie.base().get())) {
+        dimension += index(*base);
+    }
+    else {
+        ie.base()->accept(*this);
+    }
+    ie.index()->accept(*this);
+    auto *type = ie.base()->type();
+    if (type->typekind != semantic::TypeKind::array_type) {
+        diags_->error("{}: Cannot index {}", ie.source_range(),
+                      type->canonical_name());
+        return dimension;
+    }
+    auto length = static_cast<std::uint32_t>(
+        static_cast<semantic::ArrayType *>(type)->length);
+    // The outermost index is checked with the offset, by the instruction
+    // using it
+    if (dimension > 1) {
+        emit(bounds_checks_ ? Op::index_madd_checked : Op::index_madd, length);
+    }
+    return dimension;
+}
+
+void vm::Compiler::load(semantic::Symbol const *symbol)
+{
+    switch (symbol->storage) {
+    case semantic::StorageKind::global:
+        emit(Op::load_global, symbol->slot);
+        return;
+    case semantic::StorageKind::local:
+        emit(Op::load_local, symbol->slot);
+        return;
+    case semantic::StorageKind::none:
+        break;
+    }
+    throw std::logic_error(std::format("'{}' has no storage", symbol->name));
+}
+
+void vm::Compiler::store(semantic::Symbol const *symbol)
+{
+    switch (symbol->storage) {
+    case semantic::StorageKind::global:
+        emit(Op::store_global, symbol->slot);
+        return;
+    case semantic::StorageKind::local:
+        emit(Op::store_local, symbol->slot);
+        return;
+    case semantic::StorageKind::none:
+        break;
+    }
+    throw std::logic_error(std::format("'{}' has no storage", symbol->name));
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <ast/ast.h>
+#include <cstdint>
+#include <diagnostics.h>
+#include <unordered_map>
+#include <vm/bytecode.h>
+
+namespace vm {
+
+/// @brief Compiles a program the SemanticAnalyzer has annotated without
+/// errors to bytecode.
+///
+/// Variables are accessed by the slots the analyzer assigned, operators by
+/// their resolved opcodes, and calls by function index, so nothing is looked
+/// up by name at run time.
+class Compiler : public ast::RecursiveNodeVisitor {
+  public:
+    explicit Compiler(Diagnostics *diags);
+
+    Module compile(ast::Program &prog);
+
+    /// @brief Whether the following compilations check each index against
+    /// the length of its dimension, reporting an error if out of bounds.
+    /// On by default. Without, only the resulting offset is checked against
+    /// the array: as in C, a[0][n] is then a[1][0] if a has rows of n.
+    void set_bounds_checks(bool enabled)
+    {
+        bounds_checks_ = enabled;
+    }
+
+    void visit(ast::VariableDeclaration &vd) override;
+    void visit(ast::FunctionDeclaration &fd) override;
+
+    void visit(ast::ExpressionStatement &es) override;
+    void visit(ast::ReturnStatement &rs) override;
+    void visit(ast::IfStatement &is) override;
+    void visit(ast::WhileStatement &ws) override;
+
+    void visit(ast::CallExpression &ce) override;
+    void visit(ast::IndexExpression &ie) override;
+    void visit(ast::UnaryExpression &ue) override;
+    void visit(ast::BinaryExpression &be) override;
+    void visit(ast::IdentifierExpression &ie) override;
+    void visit(ast::IntegerLiteralExpr &ie) override;
+    void visit(ast::FloatLiteralExpr &fe) override;
+    void visit(ast::StringLiteralExpr &se) override;
+
+  private:
+    /// @brief Appends an instruction to the current function and returns
+    /// its index.
+    std::uint32_t emit(Op op, std::uint32_t operand = 0);
+
+    /// @brief Makes the jump at `at` target the next instruction.
+    void patch(std::uint32_t at);
+
+    std::uint32_t constant(semantic::Value value);
+    std::uint32_t int_constant(std::int64_t value);
+
+    /// @brief Pushes the array `ie` indexes and the row-major offset of the
+    /// element in its dimension. Returns the number of the dimension, i.e.
+    /// of indices.
+    std::uint32_t index(ast::IndexExpression &ie);
+
+    /// @brief Leaves the value of `be` on the stack only if `keep`.
+    void assignment(ast::BinaryExpression &be, bool keep);
+
+    void load(semantic::Symbol const *symbol);
+    void store(semantic::Symbol const *symbol);
+
+    Diagnostics *diags_;
+    Module module_;
+    std::unordered_map<ast::FunctionDeclaration const *, std::uint32_t>
+        function_index_;
+    std::unordered_map<std::int64_t, std::uint32_t> int_constants_;
+    Function *function_{}; // Being compiled
+    int depth_{}; // Of the operand stack at the end of function_
+    bool bounds_checks_{true};
+};
+
+} // namespace vm
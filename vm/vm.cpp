@@ -0,0 +1,369 @@
+#include <vm/vm.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <semantic/operators.h>
+#include <spdlog/spdlog.h>
+#include <utility>
+
+#if defined(__GNUC__) && !defined(HLVM_NO_COMPUTED_GOTO)
+#define HLVM_COMPUTED_GOTO 1
+#else
+#define HLVM_COMPUTED_GOTO 0
+#endif
+
+using semantic::Value;
+
+namespace {
+
+/// The outermost index of row-major `offset`, `stride` being the elements
+/// per outermost index, to report it out of bounds.
+std::int64_t outermost_index(std::int64_t offset, std::size_t stride)
+{
+    if (stride <= 1) {
+        return offset;
+    }
+    auto s = static_cast<std::int64_t>(stride);
+    return offset >= 0 ? offset / s : (offset - s + 1) / s;
+}
+
+} // namespace
+
+vm::VM::VM(Diagnostics *diags, std::size_t stack_size)
+    : diags_(diags), stack_(stack_size)
+{
+}
+
+std::optional<Value> vm::VM::run(Module const &module)
+{
+    globals_.assign(module.global_count, Value{});
+    calls_.clear();
+    if (jit_ != nullptr) {
+        native_stack_limit_ = jit::Runtime::thread_stack_limit();
+    }
+
+    auto const *fn = &module.functions.at(module.entry);
+    auto *const stack_end = stack_.data() + stack_.size();
+    Value *fp = stack_.data();
+    Value *sp = fp + fn->frame_size;
+    Instruction const *ip = fn->code.data();
+    if (fn->frame_size + fn->max_stack > stack_.size()) {
+        diags_->error("Stack overflow in '{}'", fn->name);
+        return std::nullopt;
+    }
+
+#if HLVM_COMPUTED_GOTO
+#define HLVM_VM_LABEL(name) &&op_##name,
+    static void *const dispatch_table[] = {HLVM_VM_OPS(HLVM_VM_LABEL)};
+#undef HLVM_VM_LABEL
+#define CASE(name) op_##name:
+#define DISPATCH() goto *dispatch_table[static_cast<std::size_t>(ip->op)]
+#else
+#define CASE(name) case Op::name:
+#define DISPATCH() goto dispatch
+#endif
+#define NEXT()                                                                 \
+    ++ip;                                                                      \
+    DISPATCH()
+
+// The left operand is on top, see Compiler::visit(BinaryExpression &)
+#define BINARY(name, T, as, expr)                                              \
+    CASE(name)                                                                 \
+    {                                                                          \
+        T lhs = sp[-1].as();                                                   \
+        T rhs = sp[-2].as();                                                   \
+        --sp;                                                                  \
+        sp[-1] = Value{expr};                                                  \
+        NEXT();                                                                \
+    }
+#define COMPARISON(name, T, as, op)                                            \
+    BINARY(name, T, as, static_cast<std::int64_t>(lhs op rhs))
+
+#if HLVM_COMPUTED_GOTO
+    DISPATCH();
+#else
+dispatch:
+    switch (ip->op) {
+#endif
+    CASE(push_const)
+    {
+        *sp++ = module.constants[ip->operand];
+        NEXT();
+    }
+    CASE(pop)
+    {
+        --sp;
+        NEXT();
+    }
+    CASE(dup)
+    {
+        *sp = sp[-1];
+        ++sp;
+        NEXT();
+    }
+    CASE(load_local)
+    {
+        *sp++ = fp[ip->operand];
+        NEXT();
+    }
+    CASE(store_local)
+    {
+        fp[ip->operand] = *--sp;
+        NEXT();
+    }
+    CASE(load_global)
+    {
+        *sp++ = globals_[ip->operand];
+        NEXT();
+    }
+    CASE(store_global)
+    {
+        globals_[ip->operand] = *--sp;
+        NEXT();
+    }
+    CASE(new_array)
+    {
+        *sp++ = make_array(module.array_types[ip->operand]);
+        NEXT();
+    }
+    CASE(release_local)
+    {
+        arrays_.release(fp[ip->operand]);
+        NEXT();
+    }
+    CASE(index_madd_checked)
+    {
+        auto index = sp[-1].as_int();
+        if (index < 0 || std::cmp_greater_equal(index, ip->operand)) {
+            diags_->error("Index {} out of bounds in '{}'", index, fn->name);
+            return std::nullopt;
+        }
+        --sp;
+        sp[-1] = Value{sp[-1].as_int() * ip->operand + index};
+        NEXT();
+    }
+    CASE(index_madd)
+    {
+        --sp;
+        sp[-1] = Value{sp[-1].as_int() * ip->operand + sp[0].as_int()};
+        NEXT();
+    }
+    CASE(load_element)
+    {
+        auto const *array = sp[-2].as_array();
+        auto offset = sp[-1].as_int();
+        if (offset < 0 ||
+            std::cmp_greater_equal(offset, array->length * array->stride)) {
+            diags_->error("Index {} out of bounds in '{}'",
+                          outermost_index(offset, array->stride), fn->name);
+            return std::nullopt;
+        }
+        --sp;
+        sp[-1] = array->data[offset];
+        NEXT();
+    }
+    CASE(load_row)
+    {
+        // The rows of a dimension are contiguous, starting with the rows of
+        // the first row of the dimension above
+        auto const *array = sp[-2].as_array();
+        auto *rows = array->rows;
+        auto count = array->length;
+        for (auto d = ip->operand; d > 1; --d) {
+            count *= rows->length;
+            rows = rows->rows;
+        }
+        auto offset = sp[-1].as_int();
+        if (offset < 0 || std::cmp_greater_equal(offset, count)) {
+            auto per_index = count / std::max<std::size_t>(array->length, 1);
+            diags_->error("Index {} out of bounds in '{}'",
+                          outermost_index(offset, per_index), fn->name);
+            return std::nullopt;
+        }
+        --sp;
+        sp[-1] = Value{rows + offset};
+        NEXT();
+    }
+    CASE(store_element)
+    {
+        auto *array = sp[-2].as_array();
+        auto offset = sp[-1].as_int();
+        if (offset < 0 ||
+            std::cmp_greater_equal(offset, array->length * array->stride)) {
+            diags_->error("Index {} out of bounds in '{}'",
+                          outermost_index(offset, array->stride), fn->name);
+            return std::nullopt;
+        }
+        array->data[offset] = sp[-3];
+        sp -= 3;
+        NEXT();
+    }
+    BINARY(int_add, std::int64_t, as_int, semantic::wrapping_add(lhs, rhs))
+    BINARY(int_sub, std::int64_t, as_int, semantic::wrapping_sub(lhs, rhs))
+    BINARY(int_mul, std::int64_t, as_int, semantic::wrapping_mul(lhs, rhs))
+    CASE(int_div)
+    CASE(int_mod)
+    {
+        auto lhs = sp[-1].as_int();
+        auto rhs = sp[-2].as_int();
+        if (rhs == 0) {
+            diags_->error("Division by zero in '{}'", fn->name);
+            return std::nullopt;
+        }
+        --sp;
+        sp[-1] = Value{ip->op == Op::int_div
+                           ? semantic::wrapping_div(lhs, rhs)
+                           : semantic::wrapping_mod(lhs, rhs)};
+        NEXT();
+    }
+    COMPARISON(int_eq, std::int64_t, as_int, ==)
+    COMPARISON(int_lt, std::int64_t, as_int, <)
+    COMPARISON(int_le, std::int64_t, as_int, <=)
+    COMPARISON(int_gt, std::int64_t, as_int, >)
+    COMPARISON(int_ge, std::int64_t, as_int, >=)
+    CASE(int_neg)
+    {
+        sp[-1] = Value{semantic::wrapping_neg(sp[-1].as_int())};
+        NEXT();
+    }
+    BINARY(float_add, double, as_float, lhs + rhs)
+    BINARY(float_sub, double, as_float, lhs - rhs)
+    BINARY(float_mul, double, as_float, lhs * rhs)
+    BINARY(float_div, double, as_float, lhs / rhs)
+    COMPARISON(float_eq, double, as_float, ==)
+    COMPARISON(float_lt, double, as_float, <)
+    COMPARISON(float_le, double, as_float, <=)
+    COMPARISON(float_gt, double, as_float, >)
+    COMPARISON(float_ge, double, as_float, >=)
+    CASE(float_neg)
+    {
+        sp[-1] = Value{-sp[-1].as_float()};
+        NEXT();
+    }
+    CASE(jump)
+    {
+        ip = fn->code.data() + ip->operand;
+        DISPATCH();
+    }
+    CASE(jump_if_false)
+    {
+        if ((--sp)->as_int() == 0) {
+            ip = fn->code.data() + ip->operand;
+            DISPATCH();
+        }
+        NEXT();
+    }
+    CASE(call)
+    CASE(tail_call)
+    {
+        auto const *callee = &module.functions[ip->operand];
+        auto *base = sp - callee->parameter_count;
+        if (jit_ != nullptr) {
+            auto entry = jit_->entry(ip->operand);
+            if (entry != nullptr &&
+                std::all_of(base, sp, [](Value const &v) {
+                    return v.kind() == Value::Kind::integer ||
+                           v.kind() == Value::Kind::none;
+                })) {
+                auto result = call_native(entry, module, base,
+                                          callee->parameter_count);
+                if (!result) {
+                    return std::nullopt;
+                }
+                sp = base;
+                *sp++ = Value{*result};
+                NEXT();
+            }
+        }
+        if (ip->op == Op::tail_call) {
+            // The arguments replace the frame of the caller
+            for (auto slot : fn->frame_arrays) {
+                arrays_.release(fp[slot]);
+            }
+            std::copy(base, sp, fp);
+            base = fp;
+        }
+        if (std::cmp_less(stack_end - base,
+                          callee->frame_size + callee->max_stack)) {
+            diags_->error("Stack overflow in call of '{}'", callee->name);
+            return std::nullopt;
+        }
+        if (ip->op == Op::call) {
+            calls_.push_back({.function = fn, .return_ip = ip + 1, .fp = fp});
+        }
+        fn = callee;
+        fp = base;
+        sp = base + fn->frame_size;
+        std::fill(base + fn->parameter_count, sp, Value{});
+        ip = fn->code.data();
+        DISPATCH();
+    }
+    CASE(ret)
+    {
+        auto result = sp[-1];
+        for (auto slot : fn->frame_arrays) {
+            arrays_.release(fp[slot]);
+        }
+        if (calls_.empty()) {
+            return result;
+        }
+        auto const &caller = calls_.back();
+        sp = fp;
+        *sp++ = result;
+        fn = caller.function;
+        fp = caller.fp;
+        ip = caller.return_ip;
+        calls_.pop_back();
+        DISPATCH();
+    }
+    CASE(print)
+    {
+        spdlog::info("Program printing: {}", sp[-1].to_string());
+        sp[-1] = Value{std::int64_t{}};
+        NEXT();
+    }
+#if !HLVM_COMPUTED_GOTO
+    }
+    throw std::logic_error("Invalid instruction");
+#endif
+
+#undef COMPARISON
+#undef BINARY
+#undef NEXT
+#undef DISPATCH
+#undef CASE
+}
+
+std::optional<std::int64_t> vm::VM::call_native(jit::Entry entry,
+                                                Module const &module,
+                                                Value const *args,
+                                                std::uint32_t count)
+{
+    native_args_.resize(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        native_args_[i] = args[i].as_int();
+    }
+    jit::Runtime runtime{.stack_limit = native_stack_limit_,
+                         .error = jit::Runtime::none,
+                         .function = 0,
+                         .tail_call_args{}};
+    auto result = entry(native_args_.data(), &runtime);
+    switch (runtime.error) {
+    case jit::Runtime::none:
+        return result;
+    case jit::Runtime::division_by_zero:
+        diags_->error("Division by zero in '{}'",
+                      module.functions[runtime.function].name);
+        break;
+    case jit::Runtime::stack_overflow:
+        diags_->error("Stack overflow in call of '{}'",
+                      module.functions[runtime.function].name);
+        break;
+    }
+    return std::nullopt;
+}
+
+Value vm::VM::make_array(semantic::ArrayType const *type)
+{
+    return Value{arrays_.make(type->dimensions())};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <diagnostics.h>
+#include <jit/jit.h>
+#include <optional>
+#include <semantic/value.h>
+#include <vector>
+#include <vm/bytecode.h>
+
+namespace vm {
+
+/// @brief Executes bytecode modules.
+///
+/// Frames live on one value stack: a call's arguments, already pushed by the
+/// caller, become the first slots of the callee's frame, and its operand
+/// stack follows the frame. Dispatch uses computed gotos where the compiler
+/// supports them, and a switch otherwise or if HLVM_NO_COMPUTED_GOTO is
+/// defined.
+class VM {
+  public:
+    static constexpr std::size_t default_stack_size = 1 << 20; // Values
+
+    explicit VM(Diagnostics *diags,
+                std::size_t stack_size = default_stack_size);
+
+    /// @brief Runs `module`. Returns what 'main' returns, or nullopt after
+    /// reporting a run-time error.
+    std::optional<semantic::Value> run(Module const &module);
+
+    /// @brief Routes the following calls of functions that `code` has
+    /// compiled to their native code, when all arguments are integers.
+    /// `code` must be compiled from the module run; nullptr disables it.
+    void set_jit(jit::Code const *code)
+    {
+        jit_ = code;
+    }
+
+  private:
+    struct CallFrame {
+        Function const *function;
+        Instruction const *return_ip;
+        semantic::Value *fp;
+    };
+
+    semantic::Value make_array(semantic::ArrayType const *type);
+
+    /// @brief Calls native code with the arguments at `args`, which must be
+    /// integers. Returns nullopt after reporting a run-time error.
+    std::optional<std::int64_t> call_native(jit::Entry entry,
+                                            Module const &module,
+                                            semantic::Value const *args,
+                                            std::uint32_t count);
+
+    Diagnostics *diags_;
+    std::vector<semantic::Value> stack_; // Never reallocated while running
+    std::vector<CallFrame> calls_;
+    std::vector<semantic::Value> globals_;
+    semantic::ArrayPool arrays_;
+    jit::Code const *jit_{};
+    std::vector<std::int64_t> native_args_;
+    std::uintptr_t native_stack_limit_{}; // Of the thread running
+};
+
+} // namespace vm